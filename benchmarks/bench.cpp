@@ -0,0 +1,425 @@
+#include <sys/resource.h>
+
+#include <new>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <functional>
+
+#include "../cpparse/cpparse.h"
+#include "lisp_grammar.h"
+#include "corpus.h"
+
+//! The Lisp grammar generated as code by generate_lisp.cpp, when it has been.
+#if CPPARSE_GENERATED
+#include "lisp_generated.h"
+#endif
+
+using namespace cpparse;
+
+// ******************************************************************
+//! Allocation counting - every heap allocation in the program passes through here.
+// ******************************************************************
+
+namespace
+{
+	std::size_t allocations = 0;
+	std::size_t allocated_bytes = 0;
+}
+
+namespace
+{
+	void* counted_allocate(std::size_t n)
+	{
+		allocations += 1;
+		allocated_bytes += n;
+
+		if (void* p = std::malloc(n ? n : 1))
+			return p;
+
+		throw std::bad_alloc();
+	}
+}
+
+//! The whole set is replaced, as for CPPARSE_ALLOCATION_HOOKS, so every "new" is paired with its own "delete".
+void* operator new(std::size_t n) { return counted_allocate(n); }
+void* operator new[](std::size_t n) { return counted_allocate(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+// ******************************************************************
+//! Grammars
+// ******************************************************************
+
+const std::vector<std::string> keywords = {
+	"define", "defun", "defmacro", "lambda", "let*", "letrec", "let", "if", "cond", "case",
+	"and", "or", "not", "begin", "set!", "quasiquote", "quote", "unquote", "else", "do",
+	"delay", "force", "car", "cdr"
+};
+
+parser<std::string, std::string> keyword_grammar()
+{
+	parser<std::string, std::string> choice = string(keywords[0]);
+	for (std::size_t i = 1; i < keywords.size(); ++i)
+		choice = choice | string(keywords[i]);
+
+	return many(choice >>= skip(spaces()));
+}
+
+//! The same keywords, as literals fixed at compile time.
+parser<std::string, std::string> keyword_literal_grammar()
+{
+	parser<std::string, std::string> choice = CPPARSE_LIT("define") | CPPARSE_LIT("defun") | CPPARSE_LIT("defmacro")
+		| CPPARSE_LIT("lambda") | CPPARSE_LIT("let*") | CPPARSE_LIT("letrec") | CPPARSE_LIT("let") | CPPARSE_LIT("if")
+		| CPPARSE_LIT("cond") | CPPARSE_LIT("case") | CPPARSE_LIT("and") | CPPARSE_LIT("or") | CPPARSE_LIT("not")
+		| CPPARSE_LIT("begin") | CPPARSE_LIT("set!") | CPPARSE_LIT("quasiquote") | CPPARSE_LIT("quote")
+		| CPPARSE_LIT("unquote") | CPPARSE_LIT("else") | CPPARSE_LIT("do") | CPPARSE_LIT("delay") | CPPARSE_LIT("force")
+		| CPPARSE_LIT("car") | CPPARSE_LIT("cdr");
+
+	return many(choice >>= skip(spaces()));
+}
+
+// ******************************************************************
+//! Harness
+// ******************************************************************
+
+struct options
+{
+	std::string filter;
+	std::size_t size;
+	double seconds;
+	const perf_counters* counters;
+};
+
+typedef std::chrono::steady_clock clock_type;
+
+//! Run one parse of the input, returning false if the parser did not match all of it.
+typedef std::function<bool(const std::string&)> workload;
+
+long peak_rss_kb()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+template<class P>
+workload whole(P p)
+{
+	return [p](const std::string& input)
+	{
+		buffer<std::string> buf(input);
+		auto result = p->parse(buf);
+		return result.is_just() && !buf.has_next();
+	};
+}
+
+//! Like "whole", for a parser of bytes. The input is turned into bytes once, so only the buffer's own copy is timed, as for text.
+template<class P>
+workload whole_bytes(P p, const std::string& input)
+{
+	auto data = std::make_shared<bytes>(input.begin(), input.end());
+	return [p, data](const std::string&)
+	{
+		buffer<bytes> buf(*data);
+		auto result = p->parse(buf);
+		return result.is_just() && !buf.has_next();
+	};
+}
+
+//! Write per-parse hardware counter values as JSON fields, or null where a counter is unavailable.
+void write_counters(std::ostream& json, const perf_sample& sample, std::size_t iterations)
+{
+	for (int e = 0; e < perf_sample::event_count; ++e)
+	{
+		auto event = static_cast<perf_sample::event>(e);
+		json << "\"" << perf_sample::name(event) << "_per_parse\":";
+		if (sample[event] < 0)
+			json << "null";
+		else
+			json << double(sample[event]) / iterations;
+		json << ",";
+	}
+
+	json << "\"ipc\":";
+	if (sample[perf_sample::cycles] > 0 && sample[perf_sample::instructions] >= 0)
+		json << double(sample[perf_sample::instructions]) / sample[perf_sample::cycles];
+	else
+		json << "null";
+}
+
+//! Time a workload until it has run for "seconds", then write one JSON line.
+/*! With CPPARSE_PROFILE defined, hardware counters are also reported for each tagged parser. */
+void run(const options& opt, const std::string& name, const std::string& input, const workload& w, std::ostream& json)
+{
+	if (name.find(opt.filter) == std::string::npos)
+		return;
+
+	if (!w(input))
+	{
+		std::cerr << name << ": parse failed" << std::endl;
+		std::exit(1);
+	}
+
+	std::size_t iterations = 0;
+	auto before_allocations = allocations;
+	auto before_bytes = allocated_bytes;
+
+#if CPPARSE_PROBES
+	region_counters regions(*opt.counters);
+#endif
+	auto before_counters = opt.counters->read();
+
+	auto start = clock_type::now();
+	auto elapsed = clock_type::duration::zero();
+	while (iterations < 3 || elapsed < std::chrono::duration<double>(opt.seconds))
+	{
+		w(input);
+		iterations += 1;
+		elapsed = clock_type::now() - start;
+	}
+
+	auto counted = opt.counters->read() - before_counters;
+
+	double seconds = std::chrono::duration<double>(elapsed).count();
+	double mb_per_s = input.size() * iterations / seconds / (1024.0 * 1024.0);
+	double parses_per_s = iterations / seconds;
+	double allocs_per_parse = double(allocations - before_allocations) / iterations;
+	double bytes_per_parse = double(allocated_bytes - before_bytes) / iterations;
+
+	json << "{\"benchmark\":\"" << name << "\""
+		<< ",\"input_bytes\":" << input.size()
+		<< ",\"iterations\":" << iterations
+		<< ",\"seconds\":" << seconds
+		<< ",\"mb_per_s\":" << mb_per_s
+		<< ",\"parses_per_s\":" << parses_per_s
+		<< ",\"allocs_per_parse\":" << allocs_per_parse
+		<< ",\"alloc_bytes_per_parse\":" << bytes_per_parse
+		<< ",\"peak_rss_kb\":" << peak_rss_kb() << ",";
+
+	write_counters(json, counted, iterations);
+
+#if CPPARSE_PROBES
+	json << ",\"regions\":{";
+	for (auto& r : regions.regions())
+	{
+		json << (&r == &*regions.regions().begin() ? "" : ",") << "\"" << r.first << "\":{";
+		write_counters(json, r.second, iterations);
+		json << "}";
+	}
+	json << "}";
+#endif
+
+	json << "}" << std::endl;
+
+	std::fprintf(stderr, "%-24s %10.2f MB/s %12.1f parses/s %14.1f allocs/parse\n",
+		name.c_str(), mb_per_s, parses_per_s, allocs_per_parse);
+}
+
+// compile and run: g++ -std=c++11 -O2 -pthread -o bench bench.cpp && ./bench [filter] [--size=bytes] [--seconds=s] [--out=file]
+/*! Results are written to stdout (or --out) as one JSON object per line. */
+int main(int argc, char** argv)
+{
+	perf_counters counters;
+	if (!counters.available())
+		std::cerr << "hardware counters are not available, they will be reported as null" << std::endl;
+
+	options opt = { "", 256 * 1024, 0.5, &counters };
+	std::ofstream file;
+	std::ostream* json = &std::cout;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!std::strncmp(argv[i], "--size=", 7))
+			opt.size = std::strtoul(argv[i] + 7, nullptr, 10);
+		else if (!std::strncmp(argv[i], "--seconds=", 10))
+			opt.seconds = std::strtod(argv[i] + 10, nullptr);
+		else if (!std::strncmp(argv[i], "--out=", 6))
+		{
+			file.open(argv[i] + 6);
+			json = &file;
+		}
+		else
+			opt.filter = argv[i];
+	}
+
+	corpus::random r(7);
+	std::size_t n = opt.size;
+
+	//! Primitives
+	std::string defines;
+	while (defines.size() < n)
+		defines += "define";
+	run(opt, "string", defines, whole(many(string("define"))), *json);
+
+	std::string letters;
+	while (letters.size() < n)
+		letters += r.pick(corpus::letters);
+	run(opt, "one_of", letters, whole(many(one_of(corpus::letters))), *json);
+
+	run(opt, "many", std::string(n, 'a'), whole(many(character('a'))), *json);
+
+	std::string csv = corpus::number(r);
+	while (csv.size() < n)
+		csv += "," + corpus::number(r);
+	auto number = lift<long>(many1(digit()), [](const std::string& s) { return atol(s.c_str()); });
+	run(opt, "sep_by", csv, whole(sep_by(number, character(','))), *json);
+	run(opt, "integer", csv, whole(sep_by(integer<long>(), character(','))), *json);
+
+	auto tag_block = block<std::string, std::string, std::string>()
+		->* ( character('<')                     )
+		->* ( many(none_of(">")) << tag("inner") )
+		->* ( character('>')                     )
+		^ [](const std::map<std::string, std::string>& m)
+		{
+			return m.at("inner");
+		};
+
+	std::string tags;
+	while (tags.size() < n)
+		tags += "<" + std::string(1 + r.below(12), r.pick(corpus::letters)) + ">";
+	run(opt, "block", tags, whole(many(tag_block)), *json);
+
+	//! Full grammars
+	auto lisp = lisp::grammar();
+	run(opt, "lisp/flat", corpus::flat(n), whole(lisp), *json);
+	run(opt, "lisp/nested", corpus::nested(n), whole(lisp), *json);
+	run(opt, "lisp/strings", corpus::strings(n), whole(lisp), *json);
+	run(opt, "lisp/identifiers", corpus::identifiers(n), whole(lisp), *json);
+	run(opt, "lisp/numbers", corpus::numbers(n), whole(lisp), *json);
+
+	auto compiled = lisp::grammar(true);
+	run(opt, "lisp/identifiers/dfa", corpus::identifiers(n), whole(compiled), *json);
+	run(opt, "lisp/numbers/dfa", corpus::numbers(n), whole(compiled), *json);
+#if CPPARSE_GENERATED
+	auto generated = [](const std::string& input)
+	{
+		buffer<std::string> buf(input);
+		auto result = lisp_generated::parse_expr(buf);
+		return result.is_just() && !buf.has_next();
+	};
+
+	run(opt, "lisp/flat/generated", corpus::flat(n), generated, *json);
+	run(opt, "lisp/nested/generated", corpus::nested(n), generated, *json);
+	run(opt, "lisp/identifiers/generated", corpus::identifiers(n), generated, *json);
+#endif
+
+	//! The same grammar saved as an image, and what it costs to start parsing from one instead of building the grammar.
+	auto callbacks = lisp::registered_callbacks();
+	auto image = save_image(lisp, 1);
+	grammar_image loaded(image.data(), image.size(), callbacks, 1);
+	auto from_image = [&](const std::string& input)
+	{
+		buffer<std::string> buf(input);
+		auto result = loaded.parse<lisp::token_pointer>(buf);
+		return result.is_just() && !buf.has_next();
+	};
+
+	run(opt, "lisp/flat/image", corpus::flat(n), from_image, *json);
+	run(opt, "lisp/nested/image", corpus::nested(n), from_image, *json);
+	run(opt, "lisp/identifiers/image", corpus::identifiers(n), from_image, *json);
+
+	run(opt, "lisp/startup/build", "(f x)",
+		[](const std::string& input)
+		{
+			buffer<std::string> buf(input);
+			return lisp::grammar()->parse(buf).is_just();
+		}, *json);
+
+	run(opt, "lisp/startup/image", "(f x)",
+		[&](const std::string& input)
+		{
+			grammar_image g(image.data(), image.size(), callbacks, 1);
+			buffer<std::string> buf(input);
+			return g.parse<lisp::token_pointer>(buf).is_just();
+		}, *json);
+
+	//! A small message, parsed with a new buffer each time, and with one buffer and context kept for every parse.
+	/*! The kept context only rejects failed messages, so it does not record failures. */
+	std::string message = "(set alpha (list 1 2 3) \"value\")";
+	run(opt, "lisp/message", message, whole(lisp), *json);
+
+	auto kept_context = std::make_shared<parse_context>();
+	kept_context->set_record_failures(false);
+	auto kept_buffer = std::make_shared<buffer<std::string>>(message, kept_context.get());
+	run(opt, "lisp/message/reused", message,
+		[&](const std::string& input)
+		{
+			kept_buffer->reset(input);
+			kept_context->reset();
+
+			auto result = lisp->parse(*kept_buffer);
+			return result.is_just() && !kept_buffer->has_next();
+		}, *json);
+
+	//! Changing one letter of an atom and parsing again, against parsing the whole input.
+	/*! The document is parsed once before timing; tests/incremental.cpp checks that reparses match. */
+	auto memoized = lisp::grammar(false, true);
+	auto reparse = [&](const std::string& text) -> workload
+	{
+		auto doc = std::make_shared<incremental_document<parser<lisp::token_pointer, std::string>>>(memoized, text);
+		doc->parse();
+
+		std::vector<std::size_t> letters;
+		for (std::size_t i = 0; i < text.size(); ++i)
+			if (isalpha(static_cast<unsigned char>(text[i])))
+				letters.push_back(i);
+
+		std::size_t next = 0;
+		return [=](const std::string& input) mutable
+		{
+			auto at = letters[next++ % letters.size()];
+			doc->edit(at, 1, std::string(1, doc->input()[at] == 'q' ? 'z' : 'q'));
+
+			auto result = doc->parse();
+			return result.is_just() && doc->consumed() == input.size();
+		};
+	};
+
+	auto flat = corpus::flat(n);
+	auto nested = corpus::nested(n);
+	run(opt, "lisp/flat/incremental", flat, reparse(flat), *json);
+	run(opt, "lisp/nested/incremental", nested, reparse(nested), *json);
+
+	run(opt, "lisp/deep", corpus::deep(std::max<std::size_t>(1, n / 64)),
+		[&](const std::string& input)
+		{
+			buffer<std::string> buf(input);
+			auto result = parse_deep(lisp, buf);
+			return result.is_just() && !buf.has_next();
+		}, *json);
+
+	run(opt, "keywords", corpus::keyword_text(keywords, n), whole(keyword_grammar()), *json);
+	run(opt, "keywords/literal", corpus::keyword_text(keywords, n), whole(keyword_literal_grammar()), *json);
+
+	//! Binary framings: length-prefixed blobs, and a stream of small varints.
+	std::string blobs;
+	while (blobs.size() < n)
+	{
+		auto length = 256 + r.below(3840);
+		for (int shift = 24; shift >= 0; shift -= 8)
+			blobs += static_cast<char>(length >> shift);
+		blobs += std::string(length, r.pick(corpus::letters));
+	}
+	run(opt, "binary/blobs", blobs, whole_bytes(many(length_prefixed(u32_be())), blobs), *json);
+
+	std::string varints;
+	while (varints.size() < n)
+	{
+		auto v = r.below(1 << 20);
+		for (; v >= 0x80; v >>= 7)
+			varints += static_cast<char>(0x80 | (v & 0x7F));
+		varints += static_cast<char>(v);
+	}
+	run(opt, "binary/varints", varints, whole_bytes(many(varint<std::uint32_t>()), varints), *json);
+
+	return 0;
+}
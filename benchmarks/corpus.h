@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//! Deterministic inputs for the benchmarks.
+/*! Every generator takes a seed, so a corpus is the same on every run and
+ *  every machine, and results can be compared over time.
+ */
+namespace corpus
+{
+	//! A small linear congruential generator; the standard engines differ between libraries.
+	class random
+	{
+	public:
+		random(std::uint64_t seed)
+		: m_state(seed * 6364136223846793005ULL + 1442695040888963407ULL) {}
+
+		std::uint32_t next()
+		{
+			m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+			return static_cast<std::uint32_t>(m_state >> 33);
+		}
+
+		std::size_t below(std::size_t n) { return next() % n; }
+		char pick(const std::string& s) { return s[below(s.size())]; }
+
+	private:
+		std::uint64_t m_state;
+	};
+
+	const std::string letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	const std::string digits = "0123456789";
+	const std::string symbols = "!#$%&|*+-/:<=>?@^_~";
+
+	inline std::string identifier(random& r, std::size_t max_length = 12)
+	{
+		std::string s(1, r.pick(letters));
+		for (std::size_t i = r.below(max_length); i > 0; --i)
+			s += r.pick(r.below(4) ? letters : (r.below(2) ? digits : symbols));
+
+		return s;
+	}
+
+	inline std::string number(random& r, std::size_t max_digits = 9)
+	{
+		std::string s(1, r.pick("123456789"));
+		for (std::size_t i = r.below(max_digits); i > 0; --i)
+			s += r.pick(digits);
+
+		return s;
+	}
+
+	inline std::string string_literal(random& r, std::size_t length)
+	{
+		std::string s = "\"";
+		for (std::size_t i = 0; i < length; ++i)
+			s += r.below(8) ? r.pick(letters) : ' ';
+
+		return s + "\"";
+	}
+
+	//! Join generated items with single spaces into one list of roughly "size" bytes.
+	template<typename F>
+	std::string flat_list(std::size_t size, const F& item)
+	{
+		std::string s = "(";
+		while (s.size() < size)
+		{
+			if (s.size() > 1)
+				s += ' ';
+			s += item();
+		}
+
+		return s + ")";
+	}
+
+	//! A list of random atoms.
+	inline std::string flat(std::size_t size, std::uint64_t seed = 1)
+	{
+		random r(seed);
+		return flat_list(size, [&]() { return r.below(2) ? identifier(r) : number(r); });
+	}
+
+	inline std::string identifiers(std::size_t size, std::uint64_t seed = 2)
+	{
+		random r(seed);
+		return flat_list(size, [&]() { return identifier(r, 24); });
+	}
+
+	inline std::string numbers(std::size_t size, std::uint64_t seed = 3)
+	{
+		random r(seed);
+		return flat_list(size, [&]() { return number(r, 18); });
+	}
+
+	inline std::string strings(std::size_t size, std::uint64_t seed = 4)
+	{
+		random r(seed);
+		return flat_list(size, [&]() { return string_literal(r, 256 + r.below(4096)); });
+	}
+
+	inline std::string tree(random& r, std::size_t depth, std::size_t width)
+	{
+		if (!depth || !r.below(6))
+			return r.below(2) ? identifier(r) : number(r);
+
+		std::string s = "(";
+		for (std::size_t i = 1 + r.below(width); i > 0; --i)
+			s += tree(r, depth - 1, width) + (i > 1 ? " " : "");
+
+		return s + ")";
+	}
+
+	//! Lists of lists, as in typical Lisp code.
+	inline std::string nested(std::size_t size, std::uint64_t seed = 5)
+	{
+		random r(seed);
+		return flat_list(size, [&]() { return tree(r, 8, 5); });
+	}
+
+	//! A single chain of lists nested "depth" levels deep.
+	inline std::string deep(std::size_t depth)
+	{
+		return std::string(depth, '(') + "x" + std::string(depth, ')');
+	}
+
+	//! Words drawn from "keywords", separated by spaces.
+	inline std::string keyword_text(const std::vector<std::string>& keywords, std::size_t size, std::uint64_t seed = 6)
+	{
+		random r(seed);
+
+		std::string s;
+		while (s.size() < size)
+			s += keywords[r.below(keywords.size())] + " ";
+
+		return s;
+	}
+}
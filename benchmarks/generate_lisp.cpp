@@ -0,0 +1,33 @@
+#include <fstream>
+#include <iostream>
+
+#include "lisp_grammar.h"
+
+// compile and run: g++ -std=c++11 -o generate_lisp generate_lisp.cpp && ./generate_lisp lisp_generated
+/*! Writes the Lisp grammar as code, to <name>.h and <name>.cpp. The bench
+ *  uses them when built with -DCPPARSE_GENERATED.
+ */
+int main(int argc, char** argv)
+{
+	std::string name = (argc > 1) ? argv[1] : "lisp_generated";
+
+	cpparse::code_generator g("lisp_generated");
+	g.name_type<lisp::token>("lisp::token").include("\"lisp_grammar.h\"");
+	g.entry("expr", lisp::grammar());
+
+	auto slash = name.find_last_of('/');
+	auto base = (slash == std::string::npos) ? name : name.substr(slash + 1);
+
+	std::ofstream header(name + ".h");
+	std::ofstream source(name + ".cpp");
+	header << g.header();
+	source << g.source(base + ".h");
+
+	if (!header || !source)
+	{
+		std::cerr << "could not write " << name << ".h and " << name << ".cpp" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+
+#include "../cpparse/cpparse.h"
+
+//! The Lisp grammar from examples/lisp.cpp, without dotted lists.
+/*! Its functions are named with "callback", so the same grammar can be
+ *  generated as code by generate_lisp.cpp, or saved as a grammar image.
+ */
+namespace lisp
+{
+	struct token
+	{
+		std::vector<std::shared_ptr<token>> items;
+		std::string text;
+		long number;
+	};
+
+	typedef std::shared_ptr<token> token_pointer;
+
+	inline token_pointer make_atom(const std::string& s)
+	{
+		auto t = std::make_shared<token>();
+		t->text = s;
+		return t;
+	}
+
+	inline token_pointer make_number(const std::string& s)
+	{
+		auto t = std::make_shared<token>();
+		t->number = atol(s.c_str());
+		return t;
+	}
+
+	//! The same, for tokens matched by "compile_regular_span".
+	inline token_pointer make_atom_span(const cpparse::text_span& s)
+	{
+		auto t = std::make_shared<token>();
+		t->text.assign(s.begin(), s.end());
+		return t;
+	}
+
+	inline token_pointer make_number_span(const cpparse::text_span& s)
+	{
+		auto t = std::make_shared<token>();
+		t->number = 0;
+		for (char c : s)
+			t->number = t->number * 10 + (c - '0');
+
+		return t;
+	}
+
+	inline token_pointer make_string(const std::map<std::string, std::string>& m)
+	{
+		auto t = std::make_shared<token>();
+		t->text = m.at("inside");
+		return t;
+	}
+
+	inline token_pointer make_list(const std::vector<token_pointer>& v)
+	{
+		auto t = std::make_shared<token>();
+		t->items = v;
+		return t;
+	}
+
+	inline token_pointer inner(const std::map<std::string, token_pointer>& m) { return m.at("inner"); }
+
+	//! The functions above by the names the grammar gives them, for loading it from a grammar image.
+	inline cpparse::image_callbacks registered_callbacks()
+	{
+		cpparse::image_callbacks c;
+		c.add("lisp::make_atom", &make_atom).add("lisp::make_number", &make_number).add("lisp::make_string", &make_string)
+			.add("lisp::make_list", &make_list).add("lisp::inner", &inner);
+
+		return c;
+	}
+
+	//! With "compiled", atoms and numbers are matched by automata built with "compile_regular_span".
+	/*! With "memoized", each expression is a "memo" parser, for an incremental_document. */
+	inline cpparse::parser<token_pointer, std::string> grammar(bool compiled = false, bool memoized = false)
+	{
+		using namespace cpparse;
+
+		auto recurse = placeholder<token_pointer, std::string>();
+
+		parser<std::string, std::string> atom_str = lift_string(letter() | symbol()) >>= many(letter() | digit() | symbol());
+		parser<std::string, std::string> number_str = many1(digit());
+
+		parser<token_pointer, std::string> atom_lift = lift<token_pointer>(atom_str, callback("lisp::make_atom", &make_atom));
+		parser<token_pointer, std::string> number_lift = lift<token_pointer>(number_str, callback("lisp::make_number", &make_number));
+		if (compiled)
+		{
+			atom_lift = lift<token_pointer>(compile_regular_span(atom_str), &make_atom_span);
+			number_lift = lift<token_pointer>(compile_regular_span(number_str), &make_number_span);
+		}
+
+		auto string_lift = block<token_pointer, std::string, std::string>()
+			->* ( character('\"')                      )
+			->* ( many(none_of("\"")) << tag("inside") )
+			->* ( character('\"')                      )
+			^ callback("lisp::make_string", &make_string);
+
+		auto list_lift = lift<token_pointer>(sep_by(recurse, spaces()), callback("lisp::make_list", &make_list));
+
+		auto paren_parse = block<token_pointer, std::string, token_pointer>()
+			->* ( character('(')           )
+			->* ( list_lift << tag("inner") )
+			->* ( character(')')           )
+			^ callback("lisp::inner", &inner);
+
+		parser<token_pointer, std::string> expr = atom_lift | number_lift | string_lift | paren_parse;
+		if (memoized)
+			expr = memo(expr);
+
+		recurse->set_target(expr);
+
+		return freeze(recurse);
+	}
+}
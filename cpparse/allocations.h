@@ -0,0 +1,284 @@
+#pragma once
+
+#include <new>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <unordered_map>
+
+#include "detail/probe.h"
+#include "detail/parser.h"
+
+// ******************************************************************
+//! Allocator hooks
+// ******************************************************************
+
+namespace cpparse
+{
+namespace detail
+{
+	//! Told about every heap allocation made on the thread it is installed on.
+	class allocation_sink
+	{
+	public:
+		virtual ~allocation_sink() = default;
+
+		virtual void allocated(std::size_t bytes) = 0;
+		virtual void freed(std::size_t bytes) = 0;
+	};
+
+	inline allocation_sink*& current_allocation_sink()
+	{
+		static thread_local allocation_sink* sink = nullptr;
+		return sink;
+	}
+
+	inline bool& allocations_paused()
+	{
+		static thread_local bool paused = false;
+		return paused;
+	}
+
+	//! Hide allocations from the sink while in scope, so a sink can allocate for itself.
+	class allocation_pause
+	{
+	public:
+		allocation_pause()
+		: m_was(allocations_paused()) { allocations_paused() = true; }
+
+		allocation_pause(const allocation_pause&) = delete;
+		~allocation_pause() { allocations_paused() = m_was; }
+
+	private:
+		bool m_was;
+	};
+
+	//! Every tracked block starts with its size, padded to keep the block aligned for any type.
+	const std::size_t allocation_header = alignof(std::max_align_t);
+
+	inline void* tracked_allocate(std::size_t n)
+	{
+		auto block = static_cast<char*>(std::malloc(n + allocation_header));
+		if (!block)
+			throw std::bad_alloc();
+
+		*reinterpret_cast<std::size_t*>(block) = n;
+
+		auto sink = current_allocation_sink();
+		if (sink && !allocations_paused())
+		{
+			allocation_pause pause;
+			sink->allocated(n);
+		}
+
+		return block + allocation_header;
+	}
+
+	inline void tracked_free(void* p)
+	{
+		if (!p)
+			return;
+
+		auto block = static_cast<char*>(p) - allocation_header;
+
+		auto sink = current_allocation_sink();
+		if (sink && !allocations_paused())
+		{
+			allocation_pause pause;
+			sink->freed(*reinterpret_cast<std::size_t*>(block));
+		}
+
+		std::free(block);
+	}
+}
+}
+
+//! Replace the global "operator new" and "operator delete" with the tracked versions.
+/*! Use this once, at namespace scope, in one source file of the program.
+ *  The program then owns the global allocator, so it cannot be combined
+ *  with another replacement (a benchmark counter, a debugging allocator).
+ */
+#if defined(__cpp_sized_deallocation)
+#define CPPARSE_SIZED_DELETE_HOOKS \
+	void operator delete(void* p, std::size_t) noexcept { cpparse::detail::tracked_free(p); } \
+	void operator delete[](void* p, std::size_t) noexcept { cpparse::detail::tracked_free(p); }
+#else
+#define CPPARSE_SIZED_DELETE_HOOKS
+#endif
+
+#define CPPARSE_ALLOCATION_HOOKS \
+	void* operator new(std::size_t n) { return cpparse::detail::tracked_allocate(n); } \
+	void* operator new[](std::size_t n) { return cpparse::detail::tracked_allocate(n); } \
+	void operator delete(void* p) noexcept { cpparse::detail::tracked_free(p); } \
+	void operator delete[](void* p) noexcept { cpparse::detail::tracked_free(p); } \
+	CPPARSE_SIZED_DELETE_HOOKS
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Allocation Tracker
+	// ******************************************************************
+
+	//! Heap use of one parse.
+	struct allocation_stats
+	{
+		std::size_t allocations;
+		std::size_t bytes;
+
+		//! The most that memory in use grew by during the parse, counting the result.
+		std::size_t peak_live;
+
+		allocation_stats()
+		: allocations(0), bytes(0), peak_live(0) {}
+	};
+
+	//! Count the heap allocations made by parses on this thread.
+	/*! Needs cpparse compiled with CPPARSE_TRACK_ALLOCATIONS, and
+	 *  CPPARSE_ALLOCATION_HOOKS in one source file of the program; without
+	 *  them nothing is recorded.
+	 *
+	 *  Every outermost "parse" call gets its own "allocation_stats", and each
+	 *  allocation is also charged to the parser that was running when it was
+	 *  made (not to the parsers that called it). Allocations made outside a
+	 *  parse are ignored. Only one tracker counts at a time: a newer tracker
+	 *  takes over until it is destroyed.
+	 */
+	class allocation_tracker : public detail::parse_probe, public detail::allocation_sink
+	{
+	public:
+		//! Allocations charged to one parser, over all its calls.
+		struct entry
+		{
+			std::string name;
+			std::size_t calls;
+			std::size_t allocations;
+			std::size_t bytes;
+		};
+
+	public:
+		allocation_tracker()
+		: m_previous(detail::current_allocation_sink()), m_live(0)
+		{
+			detail::attach_probe(this);
+			detail::current_allocation_sink() = this;
+		}
+
+		allocation_tracker(const allocation_tracker&) = delete;
+		~allocation_tracker()
+		{
+			detail::current_allocation_sink() = m_previous;
+			detail::detach_probe(this);
+		}
+
+		void clear()
+		{
+			detail::allocation_pause pause;
+
+			m_parses.clear();
+			m_entries.clear();
+			m_stack.clear();
+		}
+
+		//! One entry per outermost parse, oldest first.
+		const std::vector<allocation_stats>& parses() const { return m_parses; }
+
+		//! The most recent outermost parse, or zeros if there has been none.
+		allocation_stats last() const
+		{
+			return m_parses.empty() ? allocation_stats() : m_parses.back();
+		}
+
+		//! Every parser that was called, with the most bytes allocated first.
+		std::vector<entry> entries() const
+		{
+			std::vector<entry> sorted;
+			for (auto& e : m_entries)
+				sorted.push_back(e.second);
+
+			std::sort(sorted.begin(), sorted.end(),
+				[](const entry& a, const entry& b) { return a.bytes > b.bytes; });
+
+			return sorted;
+		}
+
+		//! Write a table of the entries.
+		void report(std::ostream& out) const
+		{
+			out << std::left << std::setw(40) << "parser" << std::right
+				<< std::setw(10) << "calls" << std::setw(12) << "allocs" << std::setw(14) << "bytes"
+				<< std::setw(14) << "allocs/call" << "\n";
+
+			for (auto& e : entries())
+			{
+				out << std::left << std::setw(40) << e.name << std::right
+					<< std::setw(10) << e.calls << std::setw(12) << e.allocations << std::setw(14) << e.bytes
+					<< std::setw(14) << std::fixed << std::setprecision(2) << double(e.allocations) / e.calls << "\n";
+			}
+		}
+
+		void enter(const detail::parser_node& node, std::size_t)
+		{
+			detail::allocation_pause pause;
+
+			auto& found = m_entries[&node];
+			if (!found.calls)
+				found.name = detail::probe_name(node.tag(), node.kind(), m_stack.empty() ? nullptr : &m_stack.back()->name);
+
+			found.calls += 1;
+
+			if (m_stack.empty())
+			{
+				m_current = allocation_stats();
+				m_live = 0;
+			}
+
+			m_stack.push_back(&found);
+		}
+
+		void leave(const detail::parser_node&, std::size_t, bool)
+		{
+			detail::allocation_pause pause;
+
+			m_stack.pop_back();
+			if (m_stack.empty())
+				m_parses.push_back(m_current);
+		}
+
+		void allocated(std::size_t bytes)
+		{
+			if (m_stack.empty())
+				return;
+
+			m_stack.back()->allocations += 1;
+			m_stack.back()->bytes += bytes;
+
+			m_current.allocations += 1;
+			m_current.bytes += bytes;
+
+			m_live += static_cast<long long>(bytes);
+			if (m_live > static_cast<long long>(m_current.peak_live))
+				m_current.peak_live = static_cast<std::size_t>(m_live);
+		}
+
+		//! Freeing memory that existed before the parse can take "live" below zero.
+		void freed(std::size_t bytes)
+		{
+			if (!m_stack.empty())
+				m_live -= static_cast<long long>(bytes);
+		}
+
+	private:
+		detail::allocation_sink* m_previous;
+
+		std::vector<allocation_stats> m_parses;
+		std::unordered_map<const detail::parser_node*, entry> m_entries;
+		std::vector<entry*> m_stack;
+
+		allocation_stats m_current;
+		long long m_live;
+	};
+}
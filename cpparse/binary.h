@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "parser.h"
+#include "detail/binary.h"
+#include "detail/parser_traits.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Binary Parsers - integers and blobs from byte input.
+	// ******************************************************************
+	template<typename T>
+	using fixed_integer_parser = typename detail::parser_traits<detail::fixed_integer_parser<T>>::type_pointer;
+
+	template<typename T>
+	fixed_integer_parser<T> big_endian()
+	{
+		return make_parser<fixed_integer_parser<T>>(true);
+	}
+
+	template<typename T>
+	fixed_integer_parser<T> little_endian()
+	{
+		return make_parser<fixed_integer_parser<T>>(false);
+	}
+
+	inline fixed_integer_parser<std::uint8_t> u8() { return big_endian<std::uint8_t>(); }
+	inline fixed_integer_parser<std::uint16_t> u16_be() { return big_endian<std::uint16_t>(); }
+	inline fixed_integer_parser<std::uint16_t> u16_le() { return little_endian<std::uint16_t>(); }
+	inline fixed_integer_parser<std::uint32_t> u32_be() { return big_endian<std::uint32_t>(); }
+	inline fixed_integer_parser<std::uint32_t> u32_le() { return little_endian<std::uint32_t>(); }
+	inline fixed_integer_parser<std::uint64_t> u64_be() { return big_endian<std::uint64_t>(); }
+	inline fixed_integer_parser<std::uint64_t> u64_le() { return little_endian<std::uint64_t>(); }
+
+	// ******************************************************************
+	//! Varint Parser - LEB128 variable-length integers.
+	// ******************************************************************
+	template<typename T>
+	using varint_parser = typename detail::parser_traits<detail::varint_parser<T>>::type_pointer;
+
+	template<typename T = std::uint64_t>
+	varint_parser<T> varint()
+	{
+		return make_parser<varint_parser<T>>(false);
+	}
+
+	//! A signed varint in zigzag encoding.
+	template<typename T = std::int64_t>
+	varint_parser<T> zigzag_varint()
+	{
+		static_assert(std::is_signed<T>::value, "cpparse::zigzag_varint : T must be signed!");
+		return make_parser<varint_parser<T>>(true);
+	}
+
+	// ******************************************************************
+	//! Span Parsers - runs of bytes, returned without copying.
+	// ******************************************************************
+	using take_parser = typename detail::parser_traits<detail::take_parser>::type_pointer;
+	template<typename L>
+	using length_prefixed_parser = typename detail::parser_traits<detail::length_prefixed_parser<L>>::type_pointer;
+	using magic_parser = typename detail::parser_traits<detail::magic_parser>::type_pointer;
+
+	inline take_parser take(std::size_t n)
+	{
+		return make_parser<take_parser>(n);
+	}
+
+	//! A length, parsed by "p", followed by that many bytes, e.g. "length_prefixed(u32_be())".
+	template<class P>
+	length_prefixed_parser<out_type<P>> length_prefixed(P p)
+	{
+		static_assert(std::is_integral<out_type<P>>::value, "cpparse::length_prefixed : The length must be an integer!");
+		return make_parser<length_prefixed_parser<out_type<P>>>(p);
+	}
+
+	inline magic_parser magic(const bytes& b)
+	{
+		return make_parser<magic_parser>(b);
+	}
+}
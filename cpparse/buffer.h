@@ -1,8 +1,11 @@
 #pragma once
 
 #include <iterator>
+#include <algorithm>
 
 #include "maybe.h"
+#include "context.h"
+#include "detail/probe.h"
 
 namespace cpparse
 {
@@ -16,28 +19,139 @@ namespace cpparse
 		typedef typename iterator::value_type value_type;
 
 	public:
-		buffer(const container_type& d)
-		: m_data(d), m_current(m_data.begin()) {}
+		buffer(const container_type& d, parse_context* c = nullptr)
+		: m_data(d), m_current(m_data.begin()), m_context(c), m_cut(0), m_examined(0), m_utf8(~std::size_t(0)) {}
 		
-		buffer(const buffer&) = default;
+		//! The copy gets its own data, so its position has to be moved over to it.
+		buffer(const buffer& other)
+		: m_data(other.m_data), m_current(std::next(m_data.cbegin(), other.offset())), m_context(other.m_context), m_cut(other.m_cut), m_examined(other.m_examined), m_utf8(other.m_utf8) {}
+
+		buffer& operator=(const buffer& other)
+		{
+			m_data = other.m_data;
+			m_current = std::next(m_data.cbegin(), other.offset());
+			m_context = other.m_context;
+			m_cut = other.m_cut;
+			m_examined = other.m_examined;
+			m_utf8 = other.m_utf8;
+
+			return *this;
+		}
+
 		~buffer() = default;
 
+		//! Start over on new data, reusing the buffer's storage, e.g. for the next of many small messages.
+		/*! The context is kept; reset it as well for a new parse. */
+		void reset(const container_type& d)
+		{
+			m_data = d;
+			m_current = m_data.cbegin();
+			m_cut = 0;
+			m_examined = 0;
+			m_utf8 = ~std::size_t(0);
+		}
+
 		bool has_next() const { return (m_current != m_data.end()); }
 		maybe<value_type> next()
 		{
+			//! Finding the end looks at the input, as an edit may append to it.
 			if (!has_next())
+			{
+				examine(offset() + 1);
 				return maybe<value_type>::nothing;
+			}
 
 			return maybe<value_type>::just(*(m_current++));
 		}
 
 		iterator here() const { return m_current; }
-		void rewind(const iterator& to) { m_current = to; }
+		void rewind(const iterator& to)
+		{
+			if (m_context)
+				m_context->rewound(std::distance(to, m_current));
+
+			auto from = offset();
+			if (from > m_examined)
+				m_examined = from;
+
+#if CPPARSE_PROBES
+			detail::probe_rewind(offset(), std::distance(m_data.cbegin(), to));
+#endif
+			m_current = to;
+		}
+
+		//! Move forward past "n" values without reading them, e.g. after scanning "data" directly.
+		void advance(std::size_t n) { std::advance(m_current, n); }
+
+		//! The whole input, for parsers that scan it directly.
+		const container_type& data() const { return m_data; }
+
+		//! The number of values consumed so far.
+		std::size_t offset() const { return std::distance(m_data.cbegin(), m_current); }
 
 		value_type operator*() const { return *m_current; }
 
+		//! While a "commit" parser runs, the offset it started at, which the parse cannot go back before.
+		/*! The cut is put back when the committed parser returns, as the
+		 *  parsers around it may still rewind past it, so it is not a point
+		 *  before which input could be let go.
+		 */
+		std::size_t cut_offset() const { return m_cut; }
+		void set_cut_offset(std::size_t o) { m_cut = o; }
+
+		//! How far the parse has looked: the end of the farthest values read, even if the buffer was rewound.
+		/*! The end of the input counts as one more value, as an edit may add
+		 *  to it. Used by "memo" parsers.
+		 */
+		std::size_t examined() const { return m_examined; }
+		void set_examined(std::size_t o) { m_examined = o; }
+
+		//! Note that the values before offset "to" were read, for parsers that scan "data" without moving.
+		void examine(std::size_t to)
+		{
+			if (to > m_examined)
+				m_examined = to;
+		}
+
+		//! While a "utf8" parser runs, the offset from which the rest of the input is known to be valid UTF-8.
+		/*! Code point parsers decode without checking it again from there.
+		 *  Otherwise it is the largest offset, which nothing reaches.
+		 */
+		std::size_t utf8_offset() const { return m_utf8; }
+		void set_utf8_offset(std::size_t o) { m_utf8 = o; }
+
+		//! Optional state shared by every parser during one parse, e.g. limits.
+		parse_context* context() const { return m_context; }
+		void set_context(parse_context* c) { m_context = c; }
+
 	private:
 		container_type m_data;
 		iterator m_current;
+		parse_context* m_context;
+		std::size_t m_cut;
+		std::size_t m_examined;
+		std::size_t m_utf8;
+	};
+
+namespace detail
+{
+	//! Raise a buffer's cut offset to "o" for the lifetime of the guard, then put it back.
+	template<class B>
+	class cut_guard
+	{
+	public:
+		cut_guard(B& b, std::size_t o)
+		: m_buffer(b), m_previous(b.cut_offset())
+		{
+			m_buffer.set_cut_offset(std::max(m_previous, o));
+		}
+
+		cut_guard(const cut_guard&) = delete;
+		~cut_guard() { m_buffer.set_cut_offset(m_previous); }
+
+	private:
+		B& m_buffer;
+		std::size_t m_previous;
 	};
 }
+}
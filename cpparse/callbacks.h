@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "detail/parser.h"
+
+namespace cpparse
+{
+	//! Give a function a name, so a lift or block that calls it can be generated as code.
+	/*! e.g. "lift<long>(p, callback("to_number", &to_number))". Generated
+	 *  code calls the function by "name", so it must be declared by a header
+	 *  the generated code includes. See "code_generator".
+	 */
+	template<typename F>
+	detail::named_callback<F> callback(const std::string& name, const F& f)
+	{
+		return detail::named_callback<F>{ name, f };
+	}
+
+	//! The functions the library itself passes to lifts and blocks, by name.
+	namespace callbacks
+	{
+		//! A value that becomes a default-constructed value of whatever type it is assigned to.
+		struct empty_value
+		{
+			template<typename R>
+			operator R() const { return R(); }
+		};
+
+		//! Drop a result, e.g. one of the wrong type in a block.
+		template<typename M>
+		empty_value ignore(const M&) { return empty_value(); }
+
+		inline std::string char_string(char c) { return std::string(1, c); }
+
+		template<typename R>
+		std::vector<R> make_vector(const R& r) { return std::vector<R>(1, r); }
+
+		//! The "first" element followed by the "rest", for "sep_by" and "end_by".
+		template<typename R>
+		std::vector<R> join_separated(const std::map<std::string, std::vector<R>>& m)
+		{
+			auto& rest = m.at("rest");
+
+			std::vector<R> result;
+			result.reserve(1 + rest.size());
+			result.push_back(m.at("first")[0]);
+			for (auto& e : rest)
+				result.push_back(e);
+
+			return result;
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <typeindex>
+#include <stdexcept>
+
+#include "parser.h"
+#include "callbacks.h"
+#include "detail/codegen.h"
+#include "detail/generate_parsers.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Code Generator - write a grammar as C++ source.
+	// ******************************************************************
+
+	//! Turns grammars into recursive descent functions that call each other directly.
+	/*! Every parser reachable from an entry becomes two functions, one to
+	 *  parse and one to recognize, so there is no virtual call or shared_ptr
+	 *  between parsers. The generated parsers give the same results as the
+	 *  grammar, but do not report steps or failures to a parse_context; only
+	 *  its depth limit applies, at each placeholder.
+	 *
+	 *  Lifts and blocks must be given their functions with "callback", and
+	 *  types other than standard ones must be named with "name_type".
+	 *
+	 *      code_generator g("lisp");
+	 *      g.name_type<token_pointer>("token_pointer").include("\"token.h\"");
+	 *      g.entry("expr", grammar);
+	 *      // write g.header() to lisp.h, and g.source("lisp.h") to lisp.cpp
+	 *
+	 *  lisp.h then declares "lisp::parse_expr" and "lisp::recognize_expr".
+	 */
+	class code_generator
+	{
+	public:
+		code_generator(const std::string& name_space)
+		: m_namespace(name_space) {}
+
+		code_generator(const code_generator&) = delete;
+		~code_generator() = default;
+
+		//! The spelling of "T" in generated code, e.g. "std::shared_ptr<token>".
+		template<typename T>
+		code_generator& name_type(const std::string& spelling)
+		{
+			m_generator.name_type(typeid(T), spelling);
+			return *this;
+		}
+
+		//! A header the generated code needs, with its quotes or brackets, e.g. "\"token.h\"".
+		code_generator& include(const std::string& header)
+		{
+			m_includes += "#include " + header + "\n";
+			return *this;
+		}
+
+		//! Generate "p" and everything it uses, as "parse_<name>" and "recognize_<name>".
+		/*! Throws std::logic_error for a parser that cannot be generated,
+		 *  e.g. a "dfa", or a lift without a callback name.
+		 */
+		template<class P>
+		code_generator& entry(const std::string& name, P p)
+		{
+			auto id = m_generator.id(p.get());
+
+			const detail::parser_node* node;
+			while (m_generator.take(node))
+			{
+				if (!node->generate(m_generator))
+					throw std::logic_error(std::string("cpparse::code_generator : Cannot generate a \"") + node->kind() + "\" parser!");
+			}
+
+			auto maybe = "cpparse::maybe<" + m_generator.type<out_type<P>>() + ">";
+			auto buffer = "cpparse::buffer<" + m_generator.type<in_type<P>>() + ">& b";
+
+			m_declarations += "\t" + maybe + " parse_" + name + "(" + buffer + ");\n";
+			m_declarations += "\tbool recognize_" + name + "(" + buffer + ");\n";
+
+			m_entries += "\t" + maybe + " parse_" + name + "(" + buffer + ") { return parse_" + id + "(b); }\n";
+			m_entries += "\tbool recognize_" + name + "(" + buffer + ") { return recognize_" + id + "(b); }\n";
+			return *this;
+		}
+
+		//! Declarations of the entries.
+		std::string header() const
+		{
+			return "// Generated by cpparse::code_generator, do not edit.\n"
+				"#pragma once\n\n"
+				"#include \"cpparse/cpparse.h\"\n" + m_includes + "\n"
+				"namespace " + m_namespace + "\n{\n" + m_declarations + "}\n";
+		}
+
+		//! Definitions of the entries and of every parser they use. "header" is how to include the header.
+		std::string source(const std::string& header) const
+		{
+			return "// Generated by cpparse::code_generator, do not edit.\n"
+				"#include \"" + header + "\"\n\n"
+				"#include <map>\n#include <string>\n#include <vector>\n#include <cstring>\n#include <algorithm>\n\n"
+				"namespace " + m_namespace + "\n{\nnamespace\n{\n"
+				+ m_generator.declarations() + "\n" + m_generator.definitions()
+				+ "}\n\n" + m_entries + "}\n";
+		}
+
+	private:
+		detail::generator m_generator;
+		std::string m_namespace;
+		std::string m_includes;
+
+		std::string m_declarations;
+		std::string m_entries;
+	};
+}
@@ -3,6 +3,7 @@
 #include <type_traits>
 
 #include "parser.h"
+#include "callbacks.h"
 #include "detail/combinator.h"
 #include "detail/parser_traits.h"
 
@@ -100,7 +101,7 @@ namespace cpparse
 		static typename B::element_type::element_pointer convert_impl(P p, std::true_type) { return p; }
 		static typename B::element_type::element_pointer convert_impl(P p, std::false_type)
 		{
-			auto make_type = [](const out_type<P>& v) { return out_type<typename B::element_type::element_pointer>(); };
+			auto make_type = callback("cpparse::callbacks::ignore", &callbacks::ignore<out_type<P>>);
 			auto lifted = lift<out_type<typename B::element_type::element_pointer>>(p, make_type);
 
 			return lifted;
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <cstddef>
+#include <stdexcept>
+
+#include "detail/scratch.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	class parser_node;
+	class memo_table;
+
+	//! Runs a function on a fresh stack, on the same thread, for "parse_deep".
+	class stack_switcher
+	{
+	public:
+		virtual void run(const std::function<void()>& f) = 0;
+
+	protected:
+		~stack_switcher() = default;
+	};
+}
+
+	//! Thrown when a parse is stopped, as opposed to simply failing.
+	/*! A failing parser returns "maybe::nothing", letting the combinators
+	 *  above it try something else. A parse_error ends the whole parse.
+	 */
+	class parse_error : public std::runtime_error
+	{
+	public:
+		parse_error(const std::string& what)
+		: std::runtime_error(what) {}
+	};
+
+	//! Thrown when input is nested deeper than the parse_context allows.
+	class depth_exceeded : public parse_error
+	{
+	public:
+		depth_exceeded()
+		: parse_error("cpparse::parse_context : Maximum nesting depth exceeded!") {}
+	};
+
+	//! Thrown when a parse uses more steps, backtracking or time than the parse_context allows.
+	class budget_exceeded : public parse_error
+	{
+	public:
+		budget_exceeded(const std::string& what)
+		: parse_error("cpparse::parse_context : " + what + " budget exceeded!") {}
+	};
+
+	//! Thrown when a committed parser fails, so no alternatives are tried.
+	/*! A context attached to the buffer still records the farthest failure,
+	 *  so "diagnose" can explain it.
+	 */
+	class commit_failed : public parse_error
+	{
+	public:
+		commit_failed(std::size_t offset)
+		: parse_error("cpparse::commit : Parse failed after a commit at offset " + std::to_string(offset) + "!"), m_offset(offset) {}
+
+		//! Where the committed parser started.
+		std::size_t offset() const { return m_offset; }
+
+	private:
+		std::size_t m_offset;
+	};
+
+	//! State shared by every parser for the duration of a parse.
+	/*! Attach one to a buffer (in its constructor, or with "set_context") to
+	 *  enable the limits below. A buffer without a context parses exactly as
+	 *  before, with no limits.
+	 *
+	 *  A context belongs to one parse at a time, so each thread needs its own.
+	 *  Keeping one per thread for many parses also keeps its scratch space,
+	 *  so blocks, merges and "many" stop allocating working storage.
+	 */
+	class parse_context
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+	public:
+		parse_context()
+		: m_depth(0), m_peak_depth(0), m_max_depth(0), m_stack_limit(nullptr), m_stack_switcher(nullptr),
+		  m_steps(0), m_max_steps(0), m_rewound(0), m_max_rewound(0),
+		  m_deadline(), m_has_deadline(false), m_next_check(0),
+		  m_farthest(0), m_failures(), m_muted(0), m_record_failures(true), m_memo(nullptr), m_scratch()
+		{
+			schedule();
+		}
+
+		parse_context(const parse_context&) = default;
+		~parse_context() = default;
+
+		//! Limit how many forward parsers (i.e. levels of recursion) can be active at once.
+		/*! A max of "0" means the depth is unbounded. */
+		void set_max_depth(std::size_t d) { m_max_depth = d; }
+		std::size_t max_depth() const { return m_max_depth; }
+
+		//! Stop the parse before the stack grows below this address.
+		/*! Set automatically by "parse_deep". */
+		void set_stack_limit(const void* lowest) { m_stack_limit = static_cast<const char*>(lowest); }
+		const void* stack_limit() const { return m_stack_limit; }
+
+		//! When the stack limit is reached, continue on a stack from "s" instead of stopping.
+		/*! Set automatically by "parse_deep". Without one, the parse stops
+		 *  with "depth_exceeded" at the limit.
+		 */
+		void set_stack_switcher(detail::stack_switcher* s) { m_stack_switcher = s; }
+		detail::stack_switcher* stack_switcher() const { return m_stack_switcher; }
+
+		//! Whether the stack has grown past the limit, so a forward parser should not go deeper on it.
+		bool stack_exhausted() const
+		{
+			char marker;
+			return m_stack_limit && &marker < m_stack_limit;
+		}
+
+		//! Limit the number of parser invocations. A max of "0" means unbounded.
+		void set_max_steps(std::size_t n)
+		{
+			m_max_steps = n;
+			schedule();
+		}
+
+		//! Limit the total distance the buffer may be rewound. A max of "0" means unbounded.
+		void set_max_rewound(std::size_t n) { m_max_rewound = n; }
+
+		//! Stop the parse once this time has passed.
+		void set_deadline(const clock::time_point& t)
+		{
+			m_deadline = t;
+			m_has_deadline = true;
+			schedule();
+		}
+
+		void set_time_limit(const clock::duration& d) { set_deadline(clock::now() + d); }
+
+		void clear_deadline()
+		{
+			m_has_deadline = false;
+			schedule();
+		}
+
+		//! How much of the budget has been used so far.
+		std::size_t steps() const { return m_steps; }
+		std::size_t rewound() const { return m_rewound; }
+
+		std::size_t depth() const { return m_depth; }
+		std::size_t peak_depth() const { return m_peak_depth; }
+
+		//! The farthest offset at which a parser failed, and every parser that failed there.
+		/*! Use "diagnose" to turn these into an error message. */
+		std::size_t farthest() const { return m_farthest; }
+		const std::vector<const detail::parser_node*>& farthest_failures() const { return m_failures; }
+
+		//! Where "memo" parsers keep their matches, e.g. an incremental_document's.
+		/*! The table belongs to one input; see "incremental_document". */
+		void set_memo(detail::memo_table* m) { m_memo = m; }
+		detail::memo_table* memo() const { return m_memo; }
+
+		//! Working storage that blocks, merges and "many" reuse from one call (and parse) to the next.
+		/*! It keeps objects for every parser the context has parsed with;
+		 *  clear it after parsing with a grammar that is no longer used. A
+		 *  copy of the context starts with none.
+		 */
+		detail::scratch_space& scratch() { return m_scratch; }
+
+		//! Clear the usage counters and failures so the context can be used for another parse.
+		/*! The limits, memo table and scratch space are kept, except that a deadline is not moved. */
+		void reset()
+		{
+			m_depth = m_peak_depth = 0;
+			m_steps = m_rewound = 0;
+			m_farthest = 0;
+			m_failures.clear();
+			m_muted = m_record_failures ? 0 : 1;
+			schedule();
+		}
+
+		//! Called by every parser as it starts. Only a single compare, unless a limit is near.
+		void step()
+		{
+			if (++m_steps >= m_next_check)
+				check_budget();
+		}
+
+		//! Called by the buffer whenever it moves backwards.
+		void rewound(std::size_t distance)
+		{
+			m_rewound += distance;
+			if (m_max_rewound && m_rewound > m_max_rewound)
+				throw budget_exceeded("Backtracking");
+		}
+
+		//! Called by forward parsers as they pass control down and back up.
+		/*! Throws "depth_exceeded" instead of entering if either limit would be
+		 *  passed, so the thread never runs out of stack.
+		 */
+		void enter()
+		{
+			char marker;
+			if ((m_max_depth && m_depth >= m_max_depth) || (m_stack_limit && &marker < m_stack_limit))
+				throw depth_exceeded();
+
+			if (++m_depth > m_peak_depth)
+				m_peak_depth = m_depth;
+		}
+
+		void leave() { m_depth -= 1; }
+
+		//! Called by every parser that fails, with the offset it started at (and rewound to).
+		/*! Failures before the farthest one cost a single compare. */
+		void failed(const detail::parser_node& node, std::size_t offset)
+		{
+			if (offset < m_farthest || m_muted)
+				return;
+
+			if (offset > m_farthest || m_failures.empty())
+			{
+				m_farthest = offset;
+				m_failures.clear();
+			}
+			else if (std::find(m_failures.begin(), m_failures.end(), &node) != m_failures.end())
+				return;
+
+			m_failures.push_back(&node);
+		}
+
+		//! Whether failures are recorded for "diagnose" at all. On by default.
+		/*! Turning it off saves the bookkeeping when a failed parse is only
+		 *  rejected, e.g. for many small messages. Call it between parses.
+		 */
+		void set_record_failures(bool r)
+		{
+			m_record_failures = r;
+			m_muted = r ? 0 : 1;
+		}
+
+		bool record_failures() const { return m_record_failures; }
+
+		//! Stop recording failures, e.g. inside a negative lookahead, where failing is what is wanted.
+		/*! Calls nest; each "mute_failures" needs an "unmute_failures", which "detail::mute_guard" pairs up. */
+		void mute_failures() { m_muted += 1; }
+		void unmute_failures() { m_muted -= 1; }
+
+	private:
+		//! Reading the clock is slow, so the deadline is only checked this often.
+		static const std::size_t deadline_interval = 1024;
+
+		void check_budget()
+		{
+			if (m_max_steps && m_steps > m_max_steps)
+				throw budget_exceeded("Step");
+
+			if (m_has_deadline && clock::now() > m_deadline)
+				throw budget_exceeded("Time");
+
+			schedule();
+		}
+
+		//! Find the next step count at which "check_budget" has something to do.
+		void schedule()
+		{
+			m_next_check = std::numeric_limits<std::size_t>::max();
+			if (m_max_steps)
+				m_next_check = m_max_steps + 1;
+			if (m_has_deadline)
+				m_next_check = std::min(m_next_check, m_steps + deadline_interval);
+		}
+
+	private:
+		std::size_t m_depth, m_peak_depth, m_max_depth;
+		const char* m_stack_limit;
+		detail::stack_switcher* m_stack_switcher;
+
+		std::size_t m_steps, m_max_steps;
+		std::size_t m_rewound, m_max_rewound;
+
+		clock::time_point m_deadline;
+		bool m_has_deadline;
+		std::size_t m_next_check;
+
+		std::size_t m_farthest;
+		std::vector<const detail::parser_node*> m_failures;
+		std::size_t m_muted;
+		bool m_record_failures;
+
+		detail::memo_table* m_memo;
+		detail::scratch_space m_scratch;
+	};
+
+namespace detail
+{
+	//! Enter a context for the lifetime of the guard, if there is one.
+	class depth_guard
+	{
+	public:
+		depth_guard(parse_context* c)
+		: m_context(c)
+		{
+			if (m_context)
+				m_context->enter();
+		}
+
+		depth_guard(const depth_guard&) = delete;
+		~depth_guard()
+		{
+			if (m_context)
+				m_context->leave();
+		}
+
+	private:
+		parse_context* m_context;
+	};
+
+	//! Mute a context's failures for the lifetime of the guard, if there is one.
+	class mute_guard
+	{
+	public:
+		mute_guard(parse_context* c)
+		: m_context(c)
+		{
+			if (m_context)
+				m_context->mute_failures();
+		}
+
+		mute_guard(const mute_guard&) = delete;
+		~mute_guard()
+		{
+			if (m_context)
+				m_context->unmute_failures();
+		}
+
+	private:
+		parse_context* m_context;
+	};
+
+	//! The scratch space of a buffer's context, or nullptr.
+	template<class B>
+	scratch_space* scratch_of(const B& b)
+	{
+		auto context = b.context();
+		return context ? &context->scratch() : nullptr;
+	}
+}
+}
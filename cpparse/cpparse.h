@@ -5,7 +5,27 @@
 #include "accumulator.h"
 #include "parser.h"
 #include "combinator.h"
+#include "callbacks.h"
 #include "parser_utils.h"
 #include "string_parser.h"
 #include "string_combinator.h"
 #include "string_utils.h"
+#include "numeric.h"
+#include "utf8.h"
+#include "binary.h"
+#include "regular.h"
+#include "literal.h"
+#include "codegen.h"
+#include "image.h"
+#include "incremental.h"
+#include "expression.h"
+#include "lexeme.h"
+#include "parallel.h"
+#include "context.h"
+#include "deep.h"
+#include "profiler.h"
+#include "perf_counters.h"
+#include "allocations.h"
+#include "trace.h"
+#include "diagnostics.h"
+#include "precompiled.h"
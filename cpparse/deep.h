@@ -0,0 +1,76 @@
+#pragma once
+
+#include "maybe.h"
+#include "buffer.h"
+#include "parser.h"
+#include "context.h"
+#include "detail/deep_stack.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Deep Parsing - parse deeply nested input on stack segments that grow with it.
+	// ******************************************************************
+
+	/*! Each level of recursion through a placeholder costs several C++ stack
+	 *  frames, so deeply nested input can overflow a normal thread stack.
+	 *  This parses on the calling thread's own stack until it is nearly used
+	 *  up, then a forward parser moves the recursion to a new stack segment
+	 *  of "segment_size" bytes, and so on, switching stacks on the same
+	 *  thread. Shallow input never leaves the caller's stack, and nesting is
+	 *  limited by memory rather than by the size of one stack. Segments are
+	 *  reserved but only committed as they are used. Callbacks and probes
+	 *  run on the calling thread as usual. Where the thread's stack bounds
+	 *  cannot be read, the whole parse runs on segments.
+	 *
+	 *  The buffer's context (or a temporary one, if it has none) is given the
+	 *  segments. Input nested without bound, e.g. from a left-recursive
+	 *  grammar, keeps taking memory, so "parse_context::set_max_depth" is
+	 *  worth setting as well. Generated code and grammar images do not move
+	 *  to new segments; they throw "depth_exceeded" at the end of the stack
+	 *  they start on. This needs POSIX "ucontext".
+	 */
+	template<class P>
+	maybe<out_type<P>> parse_deep(P p, buffer<in_type<P>>& buf, std::size_t segment_size = std::size_t(64) << 20)
+	{
+		parse_context local;
+		parse_context* context = buf.context() ? buf.context() : &local;
+
+		auto previous_context = buf.context();
+		auto previous_limit = context->stack_limit();
+		auto previous_switcher = context->stack_switcher();
+
+		auto restore = [&]()
+		{
+			context->set_stack_limit(previous_limit);
+			context->set_stack_switcher(previous_switcher);
+			buf.set_context(previous_context);
+		};
+
+		detail::stack_pool pool(*context, segment_size);
+		auto lowest = detail::stack_bottom();
+
+		maybe<out_type<P>> result;
+		try
+		{
+			buf.set_context(context);
+			context->set_stack_switcher(&pool);
+
+			if (lowest)
+			{
+				detail::limit_stack(*context, lowest);
+				result = p->parse(buf);
+			}
+			else
+				pool.run([&]() { result = p->parse(buf); });
+		}
+		catch (...)
+		{
+			restore();
+			throw;
+		}
+
+		restore();
+		return result;
+	}
+}
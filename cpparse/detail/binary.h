@@ -0,0 +1,328 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "parser.h"
+#include "../maybe.h"
+#include "../buffer.h"
+#include "parser_traits.h"
+
+namespace cpparse
+{
+	//! Binary input: the bytes of a file or a captured stream.
+	typedef std::vector<std::uint8_t> bytes;
+
+	//! A view of bytes inside the input, which is not copied.
+	/*! The buffer copies the input once when it is made, and the span
+	 *  points into that copy, so it is valid as long as the buffer is.
+	 *  Batch parsers drop their buffers before returning, so they refuse
+	 *  grammars returning spans; copy the bytes in a lift there instead.
+	 */
+	struct byte_span
+	{
+		const std::uint8_t* data;
+		std::size_t size;
+
+		const std::uint8_t* begin() const { return data; }
+		const std::uint8_t* end() const { return data + size; }
+		std::uint8_t operator[](std::size_t i) const { return data[i]; }
+
+		bytes copy() const { return bytes(begin(), end()); }
+	};
+
+namespace detail
+{
+	template<>
+	struct refers_to_input<byte_span> : std::true_type {};
+
+	//! The bytes left in "buffer", from its position.
+	inline const std::uint8_t* remaining(const buffer<bytes>& buffer, std::size_t& n)
+	{
+		auto& data = buffer.data();
+		n = data.size() - buffer.offset();
+		return data.data() + buffer.offset();
+	}
+
+	inline std::uint8_t byte_swap(std::uint8_t v) { return v; }
+	inline std::uint16_t byte_swap(std::uint16_t v) { return static_cast<std::uint16_t>((v >> 8) | (v << 8)); }
+
+#if defined(__GNUC__)
+	inline std::uint32_t byte_swap(std::uint32_t v) { return __builtin_bswap32(v); }
+	inline std::uint64_t byte_swap(std::uint64_t v) { return __builtin_bswap64(v); }
+#else
+	inline std::uint32_t byte_swap(std::uint32_t v)
+	{
+		return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+	}
+
+	inline std::uint64_t byte_swap(std::uint64_t v)
+	{
+		return (static_cast<std::uint64_t>(byte_swap(static_cast<std::uint32_t>(v))) << 32) | byte_swap(static_cast<std::uint32_t>(v >> 32));
+	}
+#endif
+
+	inline bool little_endian_host()
+	{
+#if defined(__BYTE_ORDER__)
+		return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+#else
+		const std::uint16_t one = 1;
+		std::uint8_t first;
+		std::memcpy(&first, &one, 1);
+		return first == 1;
+#endif
+	}
+
+	//! Parse a fixed-width integer in either byte order.
+	/*! The bytes are read with one unaligned load, and swapped if the order
+	 *  differs from the machine's.
+	 */
+	template<typename T>
+	class fixed_integer_parser : public parser<T, bytes>
+	{
+		static_assert(std::is_integral<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8), "cpparse::binary : T must be an integer of 8, 16, 32 or 64 bits!");
+
+	private:
+		typedef typename std::conditional<sizeof(T) == 1, std::uint8_t,
+			typename std::conditional<sizeof(T) == 2, std::uint16_t,
+			typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type>::type>::type word_type;
+
+	public:
+		fixed_integer_parser(bool big_endian)
+		: parser<T, bytes>(), m_swap(big_endian == little_endian_host()) {}
+
+		fixed_integer_parser(const fixed_integer_parser&) = default;
+		~fixed_integer_parser() = default;
+
+		const char* kind() const { return "fixed"; }
+		std::string expected() const { return std::to_string(sizeof(T)) + "-byte integer"; }
+
+		maybe<T> apply(buffer<bytes>& buffer) const
+		{
+			std::size_t n;
+			auto p = remaining(buffer, n);
+			if (n < sizeof(T))
+			{
+				buffer.examine(buffer.offset() + sizeof(T));
+				return maybe<T>::nothing;
+			}
+
+			word_type word;
+			std::memcpy(&word, p, sizeof(word));
+			if (m_swap)
+				word = byte_swap(word);
+
+			buffer.advance(sizeof(T));
+
+			T value;
+			std::memcpy(&value, &word, sizeof(value));
+			return maybe<T>::just(value);
+		}
+
+	private:
+		bool m_swap;
+	};
+
+	//! Parse a LEB128 varint: seven bits per byte, least significant first, high bit set on all but the last.
+	/*! With "zigzag", the value is signed and encoded as in protobuf's
+	 *  "sint" types: 0, -1, 1, -2 ... as 0, 1, 2, 3 ... A value that does
+	 *  not fit in T, or a varint cut off by the end of the input, fails.
+	 */
+	template<typename T>
+	class varint_parser : public parser<T, bytes>
+	{
+		static_assert(std::is_integral<T>::value && sizeof(T) <= sizeof(std::uint64_t), "cpparse::varint : T must be an integer of at most 64 bits!");
+
+	private:
+		typedef typename std::make_unsigned<T>::type unsigned_type;
+
+	public:
+		varint_parser(bool zigzag)
+		: parser<T, bytes>(), m_zigzag(zigzag) {}
+
+		varint_parser(const varint_parser&) = default;
+		~varint_parser() = default;
+
+		const char* kind() const { return "varint"; }
+		std::string expected() const { return "varint"; }
+
+		maybe<T> apply(buffer<bytes>& buffer) const
+		{
+			std::size_t n;
+			auto p = remaining(buffer, n);
+
+			std::uint64_t raw = 0;
+			std::size_t length = 0;
+			for (unsigned shift = 0; ; shift += 7)
+			{
+				if (length == n || shift > 63)
+				{
+					buffer.examine(buffer.offset() + length + 1);
+					return maybe<T>::nothing;
+				}
+
+				std::uint64_t part = p[length] & 0x7F;
+				if (shift == 63 && part > 1)
+				{
+					buffer.examine(buffer.offset() + length + 1);
+					return maybe<T>::nothing;
+				}
+
+				raw |= part << shift;
+				if (!(p[length++] & 0x80))
+					break;
+			}
+
+			buffer.examine(buffer.offset() + length);
+			if (raw > static_cast<unsigned_type>(~unsigned_type(0)))
+				return maybe<T>::nothing;
+
+			auto bits = static_cast<unsigned_type>(raw);
+			T value;
+			if (m_zigzag)
+			{
+				//! The lowest bit is the sign, and the rest is the magnitude, less one if negative.
+				unsigned_type decoded = (bits >> 1) ^ (unsigned_type(0) - (bits & 1));
+				std::memcpy(&value, &decoded, sizeof(value));
+			}
+			else
+			{
+				if (std::is_signed<T>::value && (bits >> (sizeof(T) * 8 - 1)))
+					return maybe<T>::nothing;
+
+				value = static_cast<T>(bits);
+			}
+
+			buffer.advance(length);
+			return maybe<T>::just(value);
+		}
+
+	private:
+		bool m_zigzag;
+	};
+
+	//! Parse the next "n" bytes, as a span of the input.
+	class take_parser : public parser<byte_span, bytes>
+	{
+	public:
+		take_parser(std::size_t n)
+		: parser<byte_span, bytes>(), m_count(n) {}
+
+		take_parser(const take_parser&) = default;
+		~take_parser() = default;
+
+		const char* kind() const { return "take"; }
+		std::string expected() const { return std::to_string(m_count) + " bytes"; }
+
+		maybe<byte_span> apply(buffer<bytes>& buffer) const
+		{
+			std::size_t n;
+			auto p = remaining(buffer, n);
+			if (n < m_count)
+			{
+				buffer.examine(buffer.offset() + m_count);
+				return maybe<byte_span>::nothing;
+			}
+
+			buffer.advance(m_count);
+			return maybe<byte_span>::just(byte_span{ p, m_count });
+		}
+
+	private:
+		std::size_t m_count;
+	};
+
+	//! Parse a length with the inner parser, then that many bytes, as a span of the input.
+	template<typename L>
+	class length_prefixed_parser : public parser<byte_span, bytes>
+	{
+	private:
+		typedef typename parser_traits<parser<L, bytes>>::type_pointer length_pointer;
+
+	public:
+		length_prefixed_parser(length_pointer p)
+		: parser<byte_span, bytes>(), m_length(p) {}
+
+		length_prefixed_parser(const length_prefixed_parser&) = default;
+		~length_prefixed_parser() = default;
+
+		const char* kind() const { return "length_prefixed"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_length.get()); }
+
+		maybe<byte_span> apply(buffer<bytes>& buffer) const
+		{
+			auto start = buffer.here();
+
+			maybe<L> length = m_length->parse(buffer);
+			if (length.is_nothing())
+				return maybe<byte_span>::nothing;
+
+			std::size_t n;
+			auto p = remaining(buffer, n);
+			auto count = length.from_just();
+			if (negative(count, std::is_signed<L>()) || static_cast<unsigned long long>(count) > n)
+			{
+				buffer.examine(buffer.offset() + n + 1);
+				buffer.rewind(start);
+				return maybe<byte_span>::nothing;
+			}
+
+			buffer.advance(static_cast<std::size_t>(count));
+			return maybe<byte_span>::just(byte_span{ p, static_cast<std::size_t>(count) });
+		}
+
+	private:
+		static bool negative(L count, std::true_type) { return count < 0; }
+		static bool negative(L, std::false_type) { return false; }
+
+	private:
+		length_pointer m_length;
+	};
+
+	//! Parse an exact sequence of bytes, such as a file signature.
+	class magic_parser : public parser<byte_span, bytes>
+	{
+	public:
+		magic_parser(const bytes& b)
+		: parser<byte_span, bytes>(), m_bytes(b) {}
+
+		magic_parser(const magic_parser&) = default;
+		~magic_parser() = default;
+
+		const char* kind() const { return "magic"; }
+		std::string expected() const
+		{
+			static const char digits[] = "0123456789abcdef";
+
+			std::string hex = "bytes ";
+			for (auto b : m_bytes)
+			{
+				hex += digits[b >> 4];
+				hex += digits[b & 15];
+			}
+			return hex;
+		}
+
+		maybe<byte_span> apply(buffer<bytes>& buffer) const
+		{
+			std::size_t n;
+			auto p = remaining(buffer, n);
+			if (n < m_bytes.size() || std::memcmp(p, m_bytes.data(), m_bytes.size()))
+			{
+				buffer.examine(buffer.offset() + m_bytes.size());
+				return maybe<byte_span>::nothing;
+			}
+
+			buffer.advance(m_bytes.size());
+			return maybe<byte_span>::just(byte_span{ p, m_bytes.size() });
+		}
+
+	private:
+		bytes m_bytes;
+	};
+}
+}
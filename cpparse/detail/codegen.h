@@ -0,0 +1,340 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <sstream>
+#include <typeindex>
+#include <stdexcept>
+#include <type_traits>
+
+namespace cpparse
+{
+namespace detail
+{
+	class parser_node;
+	class generator;
+
+	//! The C++ spelling of "T" in generated code.
+	/*! Standard types are spelled here; anything else must be named with
+	 *  "code_generator::name_type".
+	 */
+	template<typename T>
+	struct type_spelling
+	{
+		static std::string get(const generator& g);
+	};
+
+	//! Writes parsers as C++ functions, for "code_generator".
+	/*! Each parser becomes a pair of functions, "parse_<n>" and
+	 *  "recognize_<n>", that call the functions of the parsers it contains
+	 *  directly. A parser describes itself from "parser_node::generate" by
+	 *  calling "define" with the bodies of its functions, written in terms
+	 *  of the buffer "b".
+	 */
+	class generator
+	{
+	public:
+		generator()
+		: m_current(0) {}
+
+		generator(const generator&) = delete;
+		~generator() = default;
+
+		void name_type(const std::type_index& t, const std::string& spelling) { m_types[t] = spelling; }
+
+		const std::string& type_name(const std::type_index& t) const
+		{
+			auto found = m_types.find(t);
+			if (found == m_types.end())
+				throw std::logic_error(std::string("cpparse::code_generator : Type \"") + t.name() + "\" has no name, see \"name_type\"!");
+
+			return found->second;
+		}
+
+		template<typename T>
+		std::string type() const { return type_spelling<T>::get(*this); }
+
+		//! The number in the names of the functions for "node". The node will be generated if it has not been yet.
+		std::string id(const parser_node* node)
+		{
+			auto found = m_ids.find(node);
+			if (found == m_ids.end())
+			{
+				found = m_ids.insert(std::make_pair(node, m_ids.size())).first;
+				m_pending.push_back(node);
+			}
+
+			return std::to_string(found->second);
+		}
+
+		//! A call to the parse function of "node", e.g. "parse_3(b)".
+		std::string parse(const parser_node* node) { return "parse_" + id(node) + "(b)"; }
+		std::string recognize(const parser_node* node) { return "recognize_" + id(node) + "(b)"; }
+
+		//! The next node waiting to be generated, if any.
+		bool take(const parser_node*& node)
+		{
+			if (m_pending.empty())
+				return false;
+
+			node = m_pending.back();
+			m_pending.pop_back();
+			m_current = m_ids[node];
+			return true;
+		}
+
+		//! Called from "parser_node::generate" with the bodies of the node's functions, for a parser<R, T>.
+		/*! Without a "recognize" body, recognizing parses and drops the result. */
+		template<typename R, typename T>
+		void define(const std::string& parse, const std::string& recognize = std::string())
+		{
+			std::string n = std::to_string(m_current);
+			std::string maybe = "cpparse::maybe<" + type<R>() + ">";
+			std::string buffer = "cpparse::buffer<" + type<T>() + ">& b";
+
+			m_declarations += "\tinline " + maybe + " parse_" + n + "(" + buffer + ");\n";
+			m_declarations += "\tinline bool recognize_" + n + "(" + buffer + ");\n";
+
+			m_definitions += "\t" + maybe + " parse_" + n + "(" + buffer + ")\n\t{\n" + indent(parse) + "\t}\n\n";
+			m_definitions += "\tbool recognize_" + n + "(" + buffer + ")\n\t{\n"
+				+ indent(recognize.empty() ? "return parse_" + n + "(b).is_just();" : recognize) + "\t}\n\n";
+		}
+
+		//! Expressions for a failed or successful result of type R.
+		template<typename R>
+		std::string nothing() const { return "cpparse::maybe<" + type<R>() + ">::nothing"; }
+
+		template<typename R>
+		std::string just(const std::string& e) const { return "cpparse::maybe<" + type<R>() + ">::just(" + e + ")"; }
+
+		//! The start of a function that reads text directly, as "d" from position "o".
+		static std::string text() { return "auto& d = b.data();\nauto o = b.offset();\n"; }
+
+		//! A condition that is true if "s" is next in the text.
+		static std::string text_is(const std::string& s)
+		{
+			auto n = std::to_string(s.size());
+			return "(d.size() - o >= " + n + " && !std::memcmp(d.data() + o, " + literal(s) + ", " + n + "))";
+		}
+
+		const std::string& declarations() const { return m_declarations; }
+		const std::string& definitions() const { return m_definitions; }
+
+		//! A character or string literal for "c" or "s", with anything unprintable escaped.
+		static std::string literal(char c) { return "'" + escape(std::string(1, c), '\'') + "'"; }
+		static std::string literal(const std::string& s) { return "\"" + escape(s, '\"') + "\""; }
+
+		//! An expression for the value "v", for types that can be written out. False for others.
+		bool value(const std::string& v, std::string& out) const
+		{
+			out = "std::string(" + literal(v) + ", " + std::to_string(v.size()) + ")";
+			return true;
+		}
+
+		bool value(char v, std::string& out) const
+		{
+			out = literal(v);
+			return true;
+		}
+
+		bool value(bool v, std::string& out) const
+		{
+			out = v ? "true" : "false";
+			return true;
+		}
+
+		template<typename R>
+		bool value(const std::vector<R>& v, std::string& out) const
+		{
+			out = type<std::vector<R>>() + "{";
+			for (auto& e : v)
+			{
+				std::string element;
+				if (!value(e, element))
+					return false;
+
+				out += (&e == &v.front() ? " " : ", ") + element;
+			}
+
+			out += v.empty() ? "}" : " }";
+			return true;
+		}
+
+		template<typename R>
+		bool value(const std::shared_ptr<R>& v, std::string& out) const
+		{
+			out = type<std::shared_ptr<R>>() + "()";
+			return !v;
+		}
+
+		template<typename R>
+		bool value(const R& v, std::string& out) const { return arithmetic_value(v, out, std::is_arithmetic<R>()); }
+
+	private:
+		template<typename R>
+		bool arithmetic_value(const R& v, std::string& out, std::true_type) const
+		{
+			std::string n;
+			if (!number(v, n, std::is_integral<R>(), std::is_signed<R>()))
+				return false;
+
+			out = "static_cast<" + type<R>() + ">(" + n + ")";
+			return true;
+		}
+
+		bool arithmetic_value(const bool& v, std::string& out, std::true_type) const
+		{
+			out = v ? "true" : "false";
+			return true;
+		}
+
+		//! Integers are widened first, so that characters come out as numbers.
+		template<typename R>
+		static bool number(const R& v, std::string& out, std::true_type, std::true_type)
+		{
+			long long n = v;
+
+			//! The smallest value has no literal of its own, as its negation overflows.
+			if (n == std::numeric_limits<long long>::min())
+				out = "(-" + std::to_string(std::numeric_limits<long long>::max()) + "LL - 1)";
+			else
+				out = std::to_string(n) + "LL";
+
+			return true;
+		}
+
+		template<typename R>
+		static bool number(const R& v, std::string& out, std::true_type, std::false_type)
+		{
+			out = std::to_string(static_cast<unsigned long long>(v)) + "ULL";
+			return true;
+		}
+
+		template<typename R, typename S>
+		static bool number(const R& v, std::string& out, std::false_type, S)
+		{
+			//! Infinities and NaN have no literal.
+			if (v != v || v - v != 0)
+				return false;
+
+			std::ostringstream s;
+			s.precision(std::numeric_limits<R>::max_digits10);
+			s << v;
+			out = s.str();
+
+			//! A floating literal, so that "-0" keeps its sign and "L" applies.
+			if (out.find_first_of(".e") == std::string::npos)
+				out += ".0";
+			if (std::is_same<R, long double>::value)
+				out += "L";
+
+			return true;
+		}
+
+		template<typename R>
+		bool arithmetic_value(const R&, std::string&, std::false_type) const { return false; }
+
+		//! Octal escapes, since they never run into a following digit the way hex escapes do.
+		static std::string escape(const std::string& s, char mark)
+		{
+			std::string escaped;
+			for (unsigned char c : s)
+			{
+				if (c == mark || c == '\\')
+					escaped += std::string(1, '\\') + char(c);
+				else if (c < 0x20 || c >= 0x7f || c == '?')
+				{
+					escaped += '\\';
+					escaped += char('0' + (c >> 6));
+					escaped += char('0' + ((c >> 3) & 7));
+					escaped += char('0' + (c & 7));
+				}
+				else
+					escaped += char(c);
+			}
+
+			return escaped;
+		}
+
+		static std::string indent(const std::string& body)
+		{
+			std::string indented;
+			std::size_t start = 0;
+			while (start < body.size())
+			{
+				auto end = body.find('\n', start);
+				if (end == std::string::npos)
+					end = body.size();
+
+				if (end > start)
+					indented += "\t\t" + body.substr(start, end - start);
+
+				indented += "\n";
+				start = end + 1;
+			}
+
+			return indented;
+		}
+
+	private:
+		std::map<std::type_index, std::string> m_types;
+		std::map<const parser_node*, std::size_t> m_ids;
+		std::vector<const parser_node*> m_pending;
+		std::size_t m_current;
+
+		std::string m_declarations;
+		std::string m_definitions;
+	};
+
+	template<typename T>
+	std::string type_spelling<T>::get(const generator& g) { return g.type_name(typeid(T)); }
+
+#define CPPARSE_SPELL_TYPE(T) \
+	template<> \
+	struct type_spelling<T> \
+	{ \
+		static std::string get(const generator&) { return #T; } \
+	};
+
+	CPPARSE_SPELL_TYPE(bool)
+	CPPARSE_SPELL_TYPE(char)
+	CPPARSE_SPELL_TYPE(signed char)
+	CPPARSE_SPELL_TYPE(unsigned char)
+	CPPARSE_SPELL_TYPE(char32_t)
+	CPPARSE_SPELL_TYPE(short)
+	CPPARSE_SPELL_TYPE(unsigned short)
+	CPPARSE_SPELL_TYPE(int)
+	CPPARSE_SPELL_TYPE(unsigned int)
+	CPPARSE_SPELL_TYPE(long)
+	CPPARSE_SPELL_TYPE(unsigned long)
+	CPPARSE_SPELL_TYPE(long long)
+	CPPARSE_SPELL_TYPE(unsigned long long)
+	CPPARSE_SPELL_TYPE(float)
+	CPPARSE_SPELL_TYPE(double)
+	CPPARSE_SPELL_TYPE(long double)
+	CPPARSE_SPELL_TYPE(std::string)
+
+#undef CPPARSE_SPELL_TYPE
+
+	template<typename T>
+	struct type_spelling<std::vector<T>>
+	{
+		static std::string get(const generator& g) { return "std::vector<" + g.type<T>() + ">"; }
+	};
+
+	template<typename K, typename V>
+	struct type_spelling<std::map<K, V>>
+	{
+		static std::string get(const generator& g) { return "std::map<" + g.type<K>() + ", " + g.type<V>() + ">"; }
+	};
+
+	template<typename T>
+	struct type_spelling<std::shared_ptr<T>>
+	{
+		static std::string get(const generator& g) { return "std::shared_ptr<" + g.type<T>() + ">"; }
+	};
+}
+}
@@ -7,6 +7,7 @@
 #include "parser.h"
 #include "../maybe.h"
 #include "../buffer.h"
+#include "../accumulator.h"
 #include "parser_traits.h"
 
 namespace cpparse
@@ -63,7 +64,18 @@ namespace detail
 		choice_combinator(const choice_combinator&) = default;
 		~choice_combinator() = default;
 
-		maybe<R> parse(buffer<T>& buffer) const
+		const char* kind() const { return "choice"; }
+		void children(std::vector<parser_node*>& c) const
+		{
+			c.push_back(m_first.get());
+			c.push_back(m_second.get());
+		}
+
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<R> apply(buffer<T>& buffer) const
 		{
 			auto first_result = m_first->parse(buffer);
 			if (first_result.is_just())
@@ -76,6 +88,11 @@ namespace detail
 			return maybe<R>::nothing;
 		}
 
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			return m_first->recognize(buffer) || m_second->recognize(buffer);
+		}
+
 	private:
 		element_pointer m_first;
 		element_pointer m_second;
@@ -97,7 +114,18 @@ namespace detail
 		sequence_combinator(const sequence_combinator&) = default;
 		~sequence_combinator() = default;
 
-		maybe<R> parse(buffer<T>& buffer) const
+		const char* kind() const { return "sequence"; }
+		void children(std::vector<parser_node*>& c) const
+		{
+			c.push_back(m_first.get());
+			c.push_back(m_second.get());
+		}
+
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<R> apply(buffer<T>& buffer) const
 		{
 			auto start = buffer.here();
 
@@ -113,6 +141,20 @@ namespace detail
 			return maybe<R>::nothing;
 		}
 
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			auto start = buffer.here();
+
+			if (!m_first->recognize(buffer))
+				return false;
+
+			if (m_second->recognize(buffer))
+				return true;
+
+			buffer.rewind(start);
+			return false;
+		}
+
 	private:
 		minor_pointer m_first;
 		major_pointer m_second;
@@ -136,7 +178,18 @@ namespace detail
 		merge_combinator(const merge_combinator&) = default;
 		~merge_combinator() = default;
 
-		maybe<result_type> parse(buffer<T>& buffer) const
+		const char* kind() const { return "merge"; }
+		void children(std::vector<parser_node*>& c) const
+		{
+			c.push_back(m_first.get());
+			c.push_back(m_second.get());
+		}
+
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<result_type> apply(buffer<T>& buffer) const
 		{
 			auto start = buffer.here();
 
@@ -144,22 +197,34 @@ namespace detail
 			if (first_result.is_nothing())
 				return maybe<result_type>::nothing;
 
-			accumulator<R> accum;
-			accum.append(first_result.from_just());
+			scratch_lease<result_type> accum(scratch_of(buffer), this);
+			join<R>::append(*accum, first_result.from_just());
 
 			auto second_result = m_second->parse(buffer);
 			if (second_result.is_just())
 			{
-				accum.append(second_result.from_just());
-
-				auto total = accum.result();
-				return maybe<result_type>::just(total);
+				join<R>::append(*accum, second_result.from_just());
+				return maybe<result_type>(*accum);
 			}
 
 			buffer.rewind(start);
 			return maybe<result_type>::nothing;
 		}
 
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			auto start = buffer.here();
+
+			if (!m_first->recognize(buffer))
+				return false;
+
+			if (m_second->recognize(buffer))
+				return true;
+
+			buffer.rewind(start);
+			return false;
+		}
+
 	private:
 		element_pointer m_first;
 		element_pointer m_second;
@@ -183,12 +248,19 @@ namespace detail
 		many_combinator(const many_combinator&) = default;
 		~many_combinator() = default;
 
-		maybe<result_type> parse(buffer<T>& buffer) const
+		const char* kind() const { return "many"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_parser.get()); }
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<result_type> apply(buffer<T>& buffer) const
 		{
 			auto start = buffer.here();
 
 			std::size_t i = 0;
-			accumulator<R> accum;
+			//! Results are collected in scratch storage, so only the result returned is allocated.
+			scratch_lease<result_type> accum(scratch_of(buffer), this);
 
 			//! A max of "0" means the max is unbounded.
 			while (!m_max || i < m_max)
@@ -198,7 +270,7 @@ namespace detail
 					break;
 
 				i += 1;
-				accum.append(next.from_just());
+				join<R>::append(*accum, next.from_just());
 			}
 
 			if (i < m_min)
@@ -207,8 +279,24 @@ namespace detail
 				return maybe<result_type>::nothing;
 			}
 
-			auto repeated = accum.result();
-			return maybe<result_type>::just(repeated);
+			return maybe<result_type>(*accum);
+		}
+
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			auto start = buffer.here();
+
+			std::size_t i = 0;
+			while ((!m_max || i < m_max) && m_parser->recognize(buffer))
+				i += 1;
+
+			if (i < m_min)
+			{
+				buffer.rewind(start);
+				return false;
+			}
+
+			return true;
 		}
 
 	private:
@@ -235,18 +323,47 @@ namespace detail
 
 		block_combinator& then(element_pointer p)
 		{
+			this->check_mutable();
 			m_statements.push_back(p);
 			return *this;
 		}
 
 		template<typename F>
-		void evaluate(const F& f) { m_function = f; }
+		void evaluate(const F& f)
+		{
+			this->check_mutable();
+			m_function = f;
+			m_callback.clear();
+		}
 
-		maybe<R> parse(buffer<T>& buffer) const
+		//! A named function can also be called from generated code.
+		template<typename F>
+		void evaluate(const named_callback<F>& f)
+		{
+			this->check_mutable();
+			m_function = f.function;
+			m_callback = f.name;
+		}
+
+		const char* kind() const { return "block"; }
+		void children(std::vector<parser_node*>& c) const
+		{
+			for (auto& p : m_statements)
+				c.push_back(p.get());
+		}
+
+		//! A block cannot run until it has been given a processing function.
+		bool complete() const { return static_cast<bool>(m_function); }
+
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<R> apply(buffer<T>& buffer) const
 		{
 			auto start = buffer.here();
 
-			std::map<std::string, M> bound;
+			//! Kept in scratch storage with its keys, so binding a result only assigns it.
+			scratch_lease<std::map<std::string, M>> bound(scratch_of(buffer), this);
 			for (auto& p : m_statements)
 			{
 				auto result = p->parse(buffer);
@@ -258,17 +375,34 @@ namespace detail
 
 				//! Only parsers with a valid tag have their results stored.
 				if (p->tag().length())
-					bound[p->tag()] = result.from_just();
+					(*bound)[p->tag()] = std::move(result.from_just());
+			}
+
+			return maybe<R>::just(m_function(*bound));
+		}
+
+		//! Nothing is bound, and the function is not called.
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			auto start = buffer.here();
+
+			for (auto& p : m_statements)
+			{
+				if (!p->recognize(buffer))
+				{
+					buffer.rewind(start);
+					return false;
+				}
 			}
 
-			auto final = m_function(bound);
-			return maybe<R>::just(final);
+			return true;
 		}
 
 	private:
 		std::vector<element_pointer> m_statements;
 		//! The function is passed a const reference to a string map of results.
 		std::function<R(const std::map<std::string, M>&)> m_function;
+		std::string m_callback;
 	};
 }
 }
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <pthread.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+
+#include "../context.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	//! Find the lowest usable address of the calling thread's stack.
+	/*! Returns nullptr where the stack bounds cannot be read. */
+	inline const void* stack_bottom()
+	{
+#if defined(__linux__)
+		pthread_attr_t attr;
+		if (pthread_getattr_np(pthread_self(), &attr))
+			return nullptr;
+
+		void* lowest = nullptr;
+		std::size_t size = 0;
+		pthread_attr_getstack(&attr, &lowest, &size);
+		pthread_attr_destroy(&attr);
+
+		return lowest;
+#else
+		return nullptr;
+#endif
+	}
+
+	//! Room left below a stack's limit for the frames between two depth checks.
+	const std::size_t stack_reserve = 256 * 1024;
+
+	//! Limit the context to the stack "lowest" is the bottom of.
+	inline void limit_stack(parse_context& c, const void* lowest)
+	{
+		c.set_stack_limit(lowest ? static_cast<const char*>(lowest) + stack_reserve : nullptr);
+	}
+
+	//! Memory for one stack segment, reserved up front but only committed as the stack grows into it.
+	class stack_memory
+	{
+	public:
+		stack_memory(std::size_t size)
+		: m_size(size), m_base(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0))
+		{
+			if (m_base == MAP_FAILED)
+				throw std::runtime_error("cpparse::stack_memory : Could not reserve a stack segment!");
+		}
+
+		stack_memory(const stack_memory&) = delete;
+		~stack_memory() { munmap(m_base, m_size); }
+
+		void* base() const { return m_base; }
+		std::size_t size() const { return m_size; }
+
+	private:
+		std::size_t m_size;
+		void* m_base;
+	};
+
+	//! A function run on another stack, and how to get back from it.
+	struct stack_call
+	{
+		const std::function<void()>* function;
+		std::exception_ptr error;
+		ucontext_t caller, callee;
+	};
+
+	//! "makecontext" only passes ints, so the call's address comes in two halves.
+	inline void stack_entry(unsigned low, unsigned high)
+	{
+		auto address = (static_cast<std::uintptr_t>(high) << 16 << 16) | low;
+		auto call = reinterpret_cast<stack_call*>(address);
+
+		try
+		{
+			(*call->function)();
+		}
+		catch (...)
+		{
+			call->error = std::current_exception();
+		}
+	}
+
+	//! Run a function on "memory" as its stack, on the calling thread, and return to the caller's stack after.
+	/*! Thread-local state (probes, tracers, allocation trackers) carries
+	 *  over, since the thread does not change. An exception thrown by the
+	 *  function is rethrown back on the caller's stack.
+	 */
+	inline void run_on_stack(const stack_memory& memory, const std::function<void()>& f)
+	{
+		stack_call call;
+		call.function = &f;
+
+		if (getcontext(&call.callee))
+			throw std::runtime_error("cpparse::run_on_stack : Could not switch stacks!");
+
+		call.callee.uc_stack.ss_sp = memory.base();
+		call.callee.uc_stack.ss_size = memory.size();
+		call.callee.uc_link = &call.caller;
+
+		auto address = reinterpret_cast<std::uintptr_t>(&call);
+		makecontext(&call.callee, reinterpret_cast<void (*)()>(&stack_entry), 2,
+			static_cast<unsigned>(address & 0xFFFFFFFFu), static_cast<unsigned>(address >> 16 >> 16));
+
+		if (swapcontext(&call.caller, &call.callee))
+			throw std::runtime_error("cpparse::run_on_stack : Could not switch stacks!");
+
+		if (call.error)
+			std::rethrow_exception(call.error);
+	}
+
+	//! The stack segments of one "parse_deep" call, for forward parsers to continue on.
+	/*! Segments are made the first time the recursion reaches them and
+	 *  kept until the parse ends, so input that keeps crossing from one
+	 *  segment to the next does not map memory each time.
+	 */
+	class stack_pool : public stack_switcher
+	{
+	public:
+		stack_pool(parse_context& c, std::size_t segment_size)
+		: m_context(c), m_size(segment_size), m_used(0) {}
+
+		stack_pool(const stack_pool&) = delete;
+		~stack_pool() = default;
+
+		void run(const std::function<void()>& f)
+		{
+			if (m_used == m_segments.size())
+				m_segments.emplace_back(new stack_memory(m_size));
+
+			auto& memory = *m_segments[m_used];
+			auto previous = m_context.stack_limit();
+
+			m_used += 1;
+			limit_stack(m_context, memory.base());
+
+			try
+			{
+				run_on_stack(memory, f);
+			}
+			catch (...)
+			{
+				leave(previous);
+				throw;
+			}
+
+			leave(previous);
+		}
+
+	private:
+		void leave(const void* previous)
+		{
+			m_used -= 1;
+			m_context.set_stack_limit(previous);
+		}
+
+	private:
+		parse_context& m_context;
+		std::size_t m_size;
+		std::size_t m_used;
+		std::vector<std::unique_ptr<stack_memory>> m_segments;
+	};
+}
+}
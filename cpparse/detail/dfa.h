@@ -0,0 +1,559 @@
+#pragma once
+
+#include <map>
+#include <bitset>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "parser.h"
+#include "regular.h"
+#include "../maybe.h"
+#include "../buffer.h"
+
+namespace cpparse
+{
+	//! A view of text inside the input, which is not copied.
+	/*! Like a "byte_span", it points into the buffer's own copy of the
+	 *  input, so it is valid as long as that buffer is, and batch parsers
+	 *  refuse grammars returning one.
+	 */
+	struct text_span
+	{
+		const char* data;
+		std::size_t size;
+
+		const char* begin() const { return data; }
+		const char* end() const { return data + size; }
+		char operator[](std::size_t i) const { return data[i]; }
+
+		std::string copy() const { return std::string(data, size); }
+	};
+
+namespace detail
+{
+	//! A minimized deterministic automaton for a regular_expression.
+	/*! Bytes are first mapped to classes, the groups of bytes every set in
+	 *  the expression treats alike, so the table has one column per class
+	 *  rather than per byte. State 0 is the dead state, from which nothing
+	 *  matches.
+	 */
+	class dfa
+	{
+	public:
+		dfa()
+		: m_classes(0), m_start(0) {}
+
+		dfa(const dfa&) = default;
+		~dfa() = default;
+
+		//! Build the automaton for expression "root" in "r". False if it would need more than "max_states" states.
+		bool build(const regular_expression& r, int root, std::size_t max_states)
+		{
+			nfa n;
+			auto fragment = n.compile(r, root, max_states * 16);
+			if (fragment.start < 0)
+				return false;
+
+			n.set_accept(fragment.end);
+			classify(r);
+
+			//! Subset construction. The empty set is the dead state, state 0.
+			std::vector<std::vector<int>> sets(1);
+			std::map<std::vector<int>, std::uint16_t> ids;
+			ids[sets[0]] = 0;
+
+			std::vector<int> start(1, fragment.start);
+			n.closure(start);
+			sets.push_back(start);
+			ids[start] = 1;
+
+			std::vector<std::uint32_t> table;
+			std::vector<bool> accepting;
+			for (std::size_t s = 0; s < sets.size(); ++s)
+			{
+				accepting.push_back(std::find(sets[s].begin(), sets[s].end(), n.accept()) != sets[s].end());
+
+				for (unsigned c = 0; c < m_classes; ++c)
+				{
+					std::vector<int> next = n.move(sets[s], m_representative[c]);
+					n.closure(next);
+
+					auto found = ids.find(next);
+					if (found == ids.end())
+					{
+						if (sets.size() >= max_states)
+							return false;
+
+						found = ids.insert(std::make_pair(next, static_cast<std::uint16_t>(sets.size()))).first;
+						sets.push_back(next);
+					}
+
+					table.push_back(found->second);
+				}
+			}
+
+			minimize(table, accepting);
+			return true;
+		}
+
+		//! The length of the longest prefix of "[p, end)" that matches, or -1 if none does.
+		std::ptrdiff_t match(const char* p, const char* end) const
+		{
+			std::size_t read;
+			return match(p, end, read);
+		}
+
+		//! Also sets "read" to how many characters were looked at, counting the end as one.
+		std::ptrdiff_t match(const char* p, const char* end, std::size_t& read) const
+		{
+			return run(m_table.data(), m_class, m_accepting.data(), m_classes, m_start, p, end, read);
+		}
+
+		std::size_t states() const { return m_accepting.size(); }
+		std::size_t classes() const { return m_classes; }
+
+		//! The automaton as bytes, for a grammar image, where "match_image" runs it in place.
+		/*! Three 32-bit words (classes, start, states), the class of each
+		 *  byte, one byte per state that is 1 if it accepts, then the table,
+		 *  aligned to 2 bytes.
+		 */
+		std::string write() const
+		{
+			std::uint32_t words[3] = { m_classes, m_start, static_cast<std::uint32_t>(states()) };
+
+			std::string image(reinterpret_cast<const char*>(words), sizeof(words));
+			image.append(reinterpret_cast<const char*>(m_class), sizeof(m_class));
+			image.append(m_accepting.begin(), m_accepting.end());
+			if (image.size() % 2)
+				image.push_back('\0');
+
+			image.append(reinterpret_cast<const char*>(m_table.data()), m_table.size() * sizeof(std::uint16_t));
+			return image;
+		}
+
+		//! False unless "image" is a whole automaton from "write", with every transition in range.
+		static bool valid_image(const char* image, std::size_t size)
+		{
+			std::uint32_t words[3];
+			if (size < sizeof(words) + 256)
+				return false;
+
+			std::memcpy(words, image, sizeof(words));
+			std::uint64_t classes = words[0], start = words[1], states = words[2];
+			if (!states || start >= states || classes > 256)
+				return false;
+
+			auto table = image_table(sizeof(words) + 256 + states);
+			if (size != table + states * classes * sizeof(std::uint16_t))
+				return false;
+
+			for (unsigned c = 0; c < 256; ++c)
+				if (static_cast<unsigned char>(image[sizeof(words) + c]) >= classes)
+					return false;
+
+			auto entries = reinterpret_cast<const std::uint16_t*>(image + table);
+			for (std::uint64_t i = 0; i < states * classes; ++i)
+				if (entries[i] >= states)
+					return false;
+
+			return true;
+		}
+
+		//! Like "match", with an automaton from "write", aligned to 4 bytes.
+		static std::ptrdiff_t match_image(const char* image, const char* p, const char* end)
+		{
+			auto words = reinterpret_cast<const std::uint32_t*>(image);
+			auto classes = reinterpret_cast<const std::uint8_t*>(image + 12);
+			auto accepting = classes + 256;
+			auto table = reinterpret_cast<const std::uint16_t*>(image + image_table(12 + 256 + words[2]));
+
+			std::size_t read;
+			return run(table, classes, accepting, words[0], words[1], p, end, read);
+		}
+
+	private:
+		static std::size_t image_table(std::size_t offset) { return offset + (offset % 2); }
+
+		static std::ptrdiff_t run(const std::uint16_t* table, const std::uint8_t* byte_class, const std::uint8_t* accepting,
+			unsigned classes, unsigned state, const char* p, const char* end, std::size_t& read)
+		{
+			std::ptrdiff_t last = accepting[state] ? 0 : -1;
+			const char* q = p;
+			while (q != end)
+			{
+				state = table[state * classes + byte_class[static_cast<unsigned char>(*q++)]];
+				if (!state)
+				{
+					read = q - p;
+					return last;
+				}
+
+				if (accepting[state])
+					last = q - p;
+			}
+
+			read = (end - p) + 1;
+			return last;
+		}
+
+		//! A Thompson automaton: each state has either byte-set edges or empty edges.
+		class nfa
+		{
+		public:
+			struct fragment
+			{
+				int start, end;
+			};
+
+		public:
+			nfa()
+			: m_accept(-1) {}
+
+			//! Build states for expression "e". The fragment's start is -1 if it would need more than "limit" states.
+			fragment compile(const regular_expression& r, int e, std::size_t limit)
+			{
+				m_limit = limit;
+				return build(r, e);
+			}
+
+			void set_accept(int s) { m_accept = s; }
+			int accept() const { return m_accept; }
+
+			//! Add every state reachable from "states" by empty edges, and sort them.
+			void closure(std::vector<int>& states) const
+			{
+				std::vector<bool> seen(m_states.size(), false);
+				std::vector<int> pending(states);
+				states.clear();
+
+				while (!pending.empty())
+				{
+					int s = pending.back();
+					pending.pop_back();
+					if (seen[s])
+						continue;
+
+					seen[s] = true;
+					states.push_back(s);
+					for (auto e : m_states[s].empty)
+						pending.push_back(e);
+				}
+
+				std::sort(states.begin(), states.end());
+			}
+
+			//! The states reached from "states" on byte "b".
+			std::vector<int> move(const std::vector<int>& states, unsigned char b) const
+			{
+				std::vector<int> next;
+				for (auto s : states)
+				{
+					auto& st = m_states[s];
+					if (st.next >= 0 && st.chars[b])
+						next.push_back(st.next);
+				}
+				return next;
+			}
+
+		private:
+			struct state
+			{
+				std::bitset<256> chars;
+				int next;
+				std::vector<int> empty;
+			};
+
+			int add()
+			{
+				m_states.push_back(state());
+				m_states.back().next = -1;
+				return static_cast<int>(m_states.size()) - 1;
+			}
+
+			fragment failed() const { return fragment{ -1, -1 }; }
+
+			fragment build(const regular_expression& r, int e)
+			{
+				if (m_states.size() > m_limit)
+					return failed();
+
+				auto& n = r.nodes()[e];
+				switch (n.kind)
+				{
+				case regular_expression::set:
+				{
+					int s = add(), t = add();
+					m_states[s].chars = n.chars;
+					m_states[s].next = t;
+					return fragment{ s, t };
+				}
+
+				case regular_expression::concat:
+				{
+					auto a = build(r, n.first);
+					if (a.start < 0)
+						return a;
+
+					auto b = build(r, n.second);
+					if (b.start < 0)
+						return b;
+
+					m_states[a.end].empty.push_back(b.start);
+					return fragment{ a.start, b.end };
+				}
+
+				case regular_expression::alternate:
+				{
+					auto a = build(r, n.first);
+					if (a.start < 0)
+						return a;
+
+					auto b = build(r, n.second);
+					if (b.start < 0)
+						return b;
+
+					int s = add(), t = add();
+					m_states[s].empty.push_back(a.start);
+					m_states[s].empty.push_back(b.start);
+					m_states[a.end].empty.push_back(t);
+					m_states[b.end].empty.push_back(t);
+					return fragment{ s, t };
+				}
+
+				case regular_expression::repeat:
+				default:
+				{
+					//! "min" required copies, then either a loop or "max - min" optional copies.
+					int s = add();
+					int end = s;
+					for (std::size_t i = 0; i < n.min; ++i)
+					{
+						auto a = build(r, n.first);
+						if (a.start < 0)
+							return a;
+
+						m_states[end].empty.push_back(a.start);
+						end = a.end;
+					}
+
+					int t = add();
+					if (!n.max)
+					{
+						auto a = build(r, n.first);
+						if (a.start < 0)
+							return a;
+
+						m_states[end].empty.push_back(a.start);
+						m_states[a.end].empty.push_back(end);
+						m_states[end].empty.push_back(t);
+					}
+					else
+					{
+						m_states[end].empty.push_back(t);
+						for (std::size_t i = n.min; i < n.max; ++i)
+						{
+							auto a = build(r, n.first);
+							if (a.start < 0)
+								return a;
+
+							m_states[end].empty.push_back(a.start);
+							m_states[a.end].empty.push_back(t);
+							end = a.end;
+						}
+					}
+
+					return fragment{ s, t };
+				}
+				}
+			}
+
+		private:
+			std::vector<state> m_states;
+			int m_accept;
+			std::size_t m_limit;
+		};
+
+		//! Group the bytes that are in exactly the same sets.
+		void classify(const regular_expression& r)
+		{
+			std::vector<const std::bitset<256>*> sets;
+			for (auto& n : r.nodes())
+				if (n.kind == regular_expression::set)
+					sets.push_back(&n.chars);
+
+			std::map<std::vector<bool>, unsigned> ids;
+			m_representative.clear();
+			for (unsigned b = 0; b < 256; ++b)
+			{
+				std::vector<bool> signature;
+				for (auto s : sets)
+					signature.push_back((*s)[b]);
+
+				auto found = ids.find(signature);
+				if (found == ids.end())
+				{
+					found = ids.insert(std::make_pair(signature, static_cast<unsigned>(m_representative.size()))).first;
+					m_representative.push_back(static_cast<unsigned char>(b));
+				}
+
+				m_class[b] = static_cast<std::uint8_t>(found->second);
+			}
+
+			m_classes = static_cast<unsigned>(m_representative.size());
+		}
+
+		//! Merge states that accept exactly the same suffixes, by refining a partition until it is stable.
+		void minimize(const std::vector<std::uint32_t>& table, const std::vector<bool>& accepting)
+		{
+			const std::size_t n = accepting.size();
+
+			//! Start with accepting and rejecting states; the dead state's group is numbered 0.
+			std::vector<std::uint32_t> group(n);
+			for (std::size_t s = 0; s < n; ++s)
+				group[s] = (accepting[s] != accepting[0]) ? 1 : 0;
+
+			std::size_t count = 0;
+			for (;;)
+			{
+				std::map<std::vector<std::uint32_t>, std::uint32_t> ids;
+				std::vector<std::uint32_t> refined(n);
+				for (std::size_t s = 0; s < n; ++s)
+				{
+					std::vector<std::uint32_t> signature(1, group[s]);
+					for (unsigned c = 0; c < m_classes; ++c)
+						signature.push_back(group[table[s * m_classes + c]]);
+
+					//! State 0 is visited first, so its group keeps the number 0.
+					auto found = ids.insert(std::make_pair(signature, static_cast<std::uint32_t>(ids.size()))).first;
+					refined[s] = found->second;
+				}
+
+				group.swap(refined);
+				if (ids.size() == count)
+					break;
+
+				count = ids.size();
+			}
+
+			m_table.assign(count * m_classes, 0);
+			m_accepting.assign(count, 0);
+			for (std::size_t s = 0; s < n; ++s)
+			{
+				m_accepting[group[s]] = accepting[s];
+				for (unsigned c = 0; c < m_classes; ++c)
+					m_table[group[s] * m_classes + c] = static_cast<std::uint16_t>(group[table[s * m_classes + c]]);
+			}
+
+			m_start = group[1];
+		}
+
+	private:
+		std::uint8_t m_class[256];
+		std::vector<unsigned char> m_representative;
+		unsigned m_classes;
+
+		std::vector<std::uint16_t> m_table;
+		std::vector<std::uint8_t> m_accepting;
+		unsigned m_start;
+	};
+
+	//! Run "d" at the position of "buffer", and move past what it matched.
+	/*! Returns the start of the match, or nullptr if nothing matched. The
+	 *  automaton reads past the match until it fails, which "examine" notes.
+	 */
+	inline const char* consume(const dfa& d, buffer<std::string>& buffer, std::size_t& length)
+	{
+		auto& data = buffer.data();
+		const char* p = data.data() + buffer.offset();
+
+		std::size_t read;
+		auto matched = d.match(p, data.data() + data.size(), read);
+		buffer.examine(buffer.offset() + read);
+		if (matched < 0)
+			return nullptr;
+
+		length = static_cast<std::size_t>(matched);
+		buffer.advance(length);
+		return p;
+	}
+
+	//! Match a regular subgrammar with a compiled automaton, in one loop over the input.
+	/*! Returns the longest prefix the subgrammar's language allows, as text.
+	 *  This is not always what the original parsers would match; see
+	 *  "compile_regular".
+	 */
+	class dfa_parser : public parser<std::string, std::string>
+	{
+	public:
+		dfa_parser(const dfa& d, const std::string& description)
+		: parser<std::string, std::string>(), m_dfa(d), m_description(description) {}
+
+		dfa_parser(const dfa_parser&) = default;
+		~dfa_parser() = default;
+
+		const char* kind() const { return "dfa"; }
+		std::string expected() const { return m_description; }
+
+		maybe<std::string> apply(buffer<std::string>& buffer) const
+		{
+			std::size_t length;
+			if (auto p = consume(m_dfa, buffer, length))
+				return maybe<std::string>::just(std::string(p, length));
+
+			return maybe<std::string>::nothing;
+		}
+
+		//! Matches without copying the text.
+		bool do_recognize(buffer<std::string>& buffer) const
+		{
+			std::size_t length;
+			return consume(m_dfa, buffer, length) != nullptr;
+		}
+
+		bool save(image_writer& w) const;
+
+		const dfa& automaton() const { return m_dfa; }
+
+	private:
+		dfa m_dfa;
+		std::string m_description;
+	};
+
+	//! Like "dfa_parser", but returns where the text it matched is in the input instead of a copy.
+	/*! Spans are not among the values of a grammar image, so it cannot be saved. */
+	class dfa_span_parser : public parser<text_span, std::string>
+	{
+	public:
+		dfa_span_parser(const dfa& d, const std::string& description)
+		: parser<text_span, std::string>(), m_dfa(d), m_description(description) {}
+
+		dfa_span_parser(const dfa_span_parser&) = default;
+		~dfa_span_parser() = default;
+
+		const char* kind() const { return "dfa_span"; }
+		std::string expected() const { return m_description; }
+
+		maybe<text_span> apply(buffer<std::string>& buffer) const
+		{
+			std::size_t length;
+			if (auto p = consume(m_dfa, buffer, length))
+				return maybe<text_span>::just(text_span{ p, length });
+
+			return maybe<text_span>::nothing;
+		}
+
+		bool do_recognize(buffer<std::string>& buffer) const
+		{
+			std::size_t length;
+			return consume(m_dfa, buffer, length) != nullptr;
+		}
+
+	private:
+		dfa m_dfa;
+		std::string m_description;
+	};
+}
+}
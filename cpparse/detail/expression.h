@@ -0,0 +1,215 @@
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include "parser.h"
+#include "../maybe.h"
+#include "../buffer.h"
+#include "parser_traits.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	//! How a chain of infix operators of the same precedence groups.
+	/*! "none" allows only one, e.g. "a < b < c" stops after "a < b". */
+	enum class associativity { left, right, none };
+
+	//! The operators an expression_parser knows, for results R and input T.
+	/*! Higher precedence binds tighter. Operators are matched with
+	 *  "recognize", so their own results are never built, and they are tried
+	 *  in the order they were added: add "<=" before "<".
+	 */
+	template<typename R, typename T>
+	class operator_table
+	{
+	public:
+		typedef std::function<R(const R&)> unary_function;
+		typedef std::function<R(const R&, const R&)> binary_function;
+
+		struct entry
+		{
+			std::shared_ptr<parser_node> node;
+			std::function<bool(buffer<T>&)> match;
+			int precedence;
+			associativity assoc;
+			unary_function unary;
+			binary_function binary;
+		};
+
+	public:
+		operator_table() = default;
+		operator_table(const operator_table&) = default;
+		~operator_table() = default;
+
+		//! "fold" is passed the left and right operands.
+		template<class P, typename F>
+		operator_table& infix(P op, int precedence, associativity a, const F& fold)
+		{
+			m_infix.push_back(make_entry(op, precedence, a));
+			m_infix.back().binary = fold;
+			return *this;
+		}
+
+		template<class P, typename F>
+		operator_table& prefix(P op, int precedence, const F& fold)
+		{
+			m_prefix.push_back(make_entry(op, precedence, associativity::right));
+			m_prefix.back().unary = fold;
+			return *this;
+		}
+
+		template<class P, typename F>
+		operator_table& postfix(P op, int precedence, const F& fold)
+		{
+			m_postfix.push_back(make_entry(op, precedence, associativity::left));
+			m_postfix.back().unary = fold;
+			return *this;
+		}
+
+		const std::vector<entry>& infix() const { return m_infix; }
+		const std::vector<entry>& prefix() const { return m_prefix; }
+		const std::vector<entry>& postfix() const { return m_postfix; }
+
+	private:
+		template<class P>
+		static entry make_entry(P op, int precedence, associativity a)
+		{
+			entry e;
+			e.node = op;
+			e.match = [op](buffer<T>& b) { return op->recognize(b); };
+			e.precedence = precedence;
+			e.assoc = a;
+			return e;
+		}
+
+	private:
+		std::vector<entry> m_infix, m_prefix, m_postfix;
+	};
+
+	//! Parse operator expressions over a primary parser by precedence climbing.
+	/*! Each operand is parsed once, and each operator is matched once per
+	 *  place it could appear, so an expression costs time in proportion to
+	 *  its length, whatever the number of precedence levels. Recursion only
+	 *  goes deeper for a tighter-binding operator, a right-associative chain
+	 *  or a prefix operator, not for each operand.
+	 *
+	 *  An infix operator that is not followed by an operand is left
+	 *  unconsumed, and the expression ends before it.
+	 */
+	template<typename R, typename T>
+	class expression_parser : public parser<R, T>
+	{
+	private:
+		typedef typename parser_traits<parser<R, T>>::type_pointer subtype_pointer;
+		typedef operator_table<R, T> table_type;
+		typedef typename table_type::entry entry;
+
+	public:
+		expression_parser(subtype_pointer primary, const table_type& table)
+		: parser<R, T>(), m_primary(primary), m_table(table) {}
+
+		expression_parser(const expression_parser&) = default;
+		~expression_parser() = default;
+
+		const char* kind() const { return "expression"; }
+		void children(std::vector<parser_node*>& c) const
+		{
+			c.push_back(m_primary.get());
+			for (auto table : { &m_table.prefix(), &m_table.infix(), &m_table.postfix() })
+				for (auto& e : *table)
+					c.push_back(e.node.get());
+		}
+
+		maybe<R> apply(buffer<T>& buffer) const
+		{
+			return climb(buffer, std::numeric_limits<int>::min());
+		}
+
+	private:
+		//! Parse an operand, followed by operators binding at least as tightly as "min".
+		maybe<R> climb(buffer<T>& buffer, int min) const
+		{
+			maybe<R> left = operand(buffer);
+			if (left.is_nothing())
+				return maybe<R>::nothing;
+
+			R value = left.from_just();
+			int ceiling = std::numeric_limits<int>::max();
+
+			for (;;)
+			{
+				auto before = buffer.here();
+
+				if (auto op = match(m_table.postfix(), buffer, min, ceiling))
+				{
+					value = op->unary(value);
+					continue;
+				}
+
+				auto op = match(m_table.infix(), buffer, min, ceiling);
+				if (!op)
+					break;
+
+				maybe<R> right = nested(buffer, op->assoc == associativity::right ? op->precedence : op->precedence + 1);
+				if (right.is_nothing())
+				{
+					buffer.rewind(before);
+					break;
+				}
+
+				value = op->binary(value, right.from_just());
+				if (op->assoc == associativity::none)
+					ceiling = op->precedence;
+			}
+
+			return maybe<R>::just(value);
+		}
+
+		//! A primary, or a prefix operator applied to an operand.
+		maybe<R> operand(buffer<T>& buffer) const
+		{
+			auto start = buffer.here();
+
+			auto op = match(m_table.prefix(), buffer, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+			if (!op)
+				return m_primary->parse(buffer);
+
+			maybe<R> inner = nested(buffer, op->precedence);
+			if (inner.is_nothing())
+			{
+				buffer.rewind(start);
+				return maybe<R>::nothing;
+			}
+
+			return maybe<R>::just(op->unary(inner.from_just()));
+		}
+
+		//! A recursive "climb", counted as a level of nesting by the buffer's context.
+		maybe<R> nested(buffer<T>& buffer, int min) const
+		{
+			depth_guard guard(buffer.context());
+			return climb(buffer, min);
+		}
+
+		//! The first operator from "table" in the precedence range [min, ceiling) that matches.
+		static const entry* match(const std::vector<entry>& table, buffer<T>& buffer, int min, int ceiling)
+		{
+			for (auto& e : table)
+			{
+				if (e.precedence >= min && e.precedence < ceiling && e.match(buffer))
+					return &e;
+			}
+
+			return nullptr;
+		}
+
+	private:
+		subtype_pointer m_primary;
+		table_type m_table;
+	};
+}
+}
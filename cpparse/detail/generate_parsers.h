@@ -0,0 +1,360 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "codegen.h"
+#include "parser.h"
+#include "combinator.h"
+#include "string_parser.h"
+#include "literal.h"
+#include "numeric.h"
+#include "memo.h"
+
+//! The "generate" hook of each parser, which writes it as C++ functions.
+/*! Kept out of the parsers' own headers, so only "code_generator" pulls
+ *  in the generator.
+ */
+namespace cpparse
+{
+namespace detail
+{
+	// ******************************************************************
+	//! Parsers
+	// ******************************************************************
+
+	//! Generate a test of the next token against a set. Only characters of text can be generated.
+	template<typename R, typename T>
+	bool generate_tokens(generator&, const std::vector<R>&, bool, const T*) { return false; }
+
+	inline bool generate_tokens(generator& g, const std::vector<char>& c, bool negate, const std::string*)
+	{
+		std::string cases;
+		for (std::size_t i = 0; i < c.size(); ++i)
+			if (std::find(c.begin(), c.begin() + i, c[i]) == c.begin() + i)
+				cases += "case " + generator::literal(c[i]) + ":\n";
+
+		std::string reject = "\treturn " + g.nothing<char>() + ";\n";
+		std::string test = generator::text() + "if (o == d.size())\n" + reject + "\n"
+			+ "switch (d[o])\n{\n" + cases + (negate ? reject + "default:\n\tbreak;\n}\n\n" : "\tbreak;\ndefault:\n" + reject + "}\n\n");
+
+		g.define<char, std::string>(test + "b.advance(1);\nreturn " + g.just<char>("d[o]") + ";");
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool forward_parser<R, T>::generate(generator& g) const
+	{
+		std::string guard = "cpparse::detail::depth_guard guard(b.context());\n";
+		g.define<R, T>(guard + "return " + g.parse(m_target.get()) + ";", guard + "return " + g.recognize(m_target.get()) + ";");
+		return true;
+	}
+
+	template<typename T, typename M>
+	bool skip_parser<T, M>::generate(generator& g) const
+	{
+		g.define<M, T>(
+			"if (" + g.parse(m_parser.get()) + ".is_nothing())\n\treturn " + g.nothing<M>() + ";\n\n"
+			"return " + g.just<M>(g.type<M>() + "()") + ";",
+			"return " + g.recognize(m_parser.get()) + ";");
+		return true;
+	}
+
+	template<typename T, typename M, typename P>
+	bool lookahead_parser<T, M, P>::generate(generator& g) const
+	{
+		std::string recognize = "auto start = b.here();\n"
+			"bool matched = " + g.recognize(m_parser.get()) + ";\n"
+			"if (matched)\n\tb.rewind(start);\n\n"
+			"return " + (m_negative ? "!matched;" : "matched;");
+
+		g.define<M, T>(
+			"if (" + g.recognize(this) + ")\n\treturn " + g.just<M>(g.type<M>() + "()") + ";\n\n"
+			"return " + g.nothing<M>() + ";",
+			recognize);
+		return true;
+	}
+
+	//! Only options whose alternate value can be written out, such as numbers, strings and empty vectors.
+	template<typename R, typename T>
+	bool option_parser<R, T>::generate(generator& g) const
+	{
+		std::string alternate;
+		if (!g.value(m_alternate, alternate))
+			return false;
+
+		g.define<R, T>(
+			"auto possible = " + g.parse(m_parser.get()) + ";\n"
+			"if (possible.is_just())\n\treturn possible;\n\n"
+			"return " + g.just<R>(alternate) + ";",
+			g.recognize(m_parser.get()) + ";\nreturn true;");
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool commit_parser<R, T>::generate(generator& g) const
+	{
+		std::string cut = "auto start = b.offset();\ncpparse::detail::cut_guard<cpparse::buffer<" + g.type<T>() + ">> cut(b, start);\n\n";
+		g.define<R, T>(
+			cut + "auto result = " + g.parse(m_parser.get()) + ";\n"
+			"if (result.is_nothing())\n\tthrow cpparse::commit_failed(start);\n\n"
+			"return result;",
+			cut + "if (!" + g.recognize(m_parser.get()) + ")\n\tthrow cpparse::commit_failed(start);\n\n"
+			"return true;");
+		return true;
+	}
+
+	template<typename R, typename T, typename M>
+	bool lift_parser<R, T, M>::generate(generator& g) const
+	{
+		if (m_callback.empty())
+			throw std::logic_error("cpparse::code_generator : A lift has no callback name, see \"callback\"!");
+
+		g.define<R, T>(
+			"auto to_lift = " + g.parse(m_parser.get()) + ";\n"
+			"if (to_lift.is_nothing())\n\treturn " + g.nothing<R>() + ";\n\n"
+			+ g.type<R>() + " lifted = " + m_callback + "(to_lift.from_just());\n"
+			"return " + g.just<R>("lifted") + ";",
+			"return " + g.recognize(m_parser.get()) + ";");
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool oneof_parser<R, T>::generate(generator& g) const { return generate_tokens(g, m_choices, false, static_cast<const T*>(nullptr)); }
+
+	template<typename R, typename T>
+	bool noneof_parser<R, T>::generate(generator& g) const { return generate_tokens(g, m_rejects, true, static_cast<const T*>(nullptr)); }
+
+	// ******************************************************************
+	//! Combinators
+	// ******************************************************************
+
+	template<typename R, typename T>
+	bool choice_combinator<R, T>::generate(generator& g) const
+	{
+		g.define<R, T>(
+			"auto first_result = " + g.parse(m_first.get()) + ";\n"
+			"if (first_result.is_just())\n\treturn first_result;\n\n"
+			"return " + g.parse(m_second.get()) + ";",
+			"return " + g.recognize(m_first.get()) + " || " + g.recognize(m_second.get()) + ";");
+		return true;
+	}
+
+	template<typename R, typename T, typename M>
+	bool sequence_combinator<R, T, M>::generate(generator& g) const
+	{
+		g.define<R, T>(
+			"auto start = b.here();\n\n"
+			"if (" + g.parse(m_first.get()) + ".is_nothing())\n\treturn " + g.nothing<R>() + ";\n\n"
+			"auto second_result = " + g.parse(m_second.get()) + ";\n"
+			"if (second_result.is_nothing())\n\tb.rewind(start);\n\n"
+			"return second_result;",
+			"auto start = b.here();\n\n"
+			"if (!" + g.recognize(m_first.get()) + ")\n\treturn false;\n\n"
+			"if (" + g.recognize(m_second.get()) + ")\n\treturn true;\n\n"
+			"b.rewind(start);\n"
+			"return false;");
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool merge_combinator<R, T>::generate(generator& g) const
+	{
+		g.define<result_type, T>(
+			"auto start = b.here();\n\n"
+			"auto first_result = " + g.parse(m_first.get()) + ";\n"
+			"if (first_result.is_nothing())\n\treturn " + g.nothing<result_type>() + ";\n\n"
+			"auto second_result = " + g.parse(m_second.get()) + ";\n"
+			"if (second_result.is_nothing())\n{\n\tb.rewind(start);\n\treturn " + g.nothing<result_type>() + ";\n}\n\n"
+			"cpparse::accumulator<" + g.type<R>() + "> accum;\n"
+			"accum.append(first_result.from_just());\n"
+			"accum.append(second_result.from_just());\n"
+			"return " + g.just<result_type>("accum.result()") + ";",
+			"auto start = b.here();\n\n"
+			"if (!" + g.recognize(m_first.get()) + ")\n\treturn false;\n\n"
+			"if (" + g.recognize(m_second.get()) + ")\n\treturn true;\n\n"
+			"b.rewind(start);\n"
+			"return false;");
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool many_combinator<R, T>::generate(generator& g) const
+	{
+		std::string more = m_max ? "i < " + std::to_string(m_max) : "true";
+		std::string start = m_min ? "auto start = b.here();\n\n" : "";
+		std::string fewer = "if (i < " + std::to_string(m_min) + ")\n{\n\tb.rewind(start);\n\treturn ";
+
+		g.define<result_type, T>(
+			start +
+			"std::size_t i = 0;\n"
+			"cpparse::accumulator<" + g.type<R>() + "> accum;\n"
+			"while (" + more + ")\n{\n"
+			"\tauto next = " + g.parse(m_parser.get()) + ";\n"
+			"\tif (next.is_nothing())\n\t\tbreak;\n\n"
+			"\ti += 1;\n"
+			"\taccum.append(next.from_just());\n}\n\n"
+			+ (m_min ? fewer + g.nothing<result_type>() + ";\n}\n\n" : "")
+			+ "return " + g.just<result_type>("accum.result()") + ";",
+			start +
+			"std::size_t i = 0;\n"
+			"while ((" + more + ") && " + g.recognize(m_parser.get()) + ")\n\ti += 1;\n\n"
+			+ (m_min ? fewer + "false;\n}\n\n" : "")
+			+ "return true;");
+		return true;
+	}
+
+	template<typename R, typename T, typename M>
+	bool block_combinator<R, T, M>::generate(generator& g) const
+	{
+		if (m_callback.empty())
+			throw std::logic_error("cpparse::code_generator : A block has no callback name, see \"callback\"!");
+
+		std::string parse = "auto start = b.here();\n\nstd::map<std::string, " + g.type<M>() + "> bound;\n";
+		std::string recognize = "auto start = b.here();\n\n";
+		for (std::size_t i = 0; i < m_statements.size(); ++i)
+		{
+			auto& p = m_statements[i];
+			std::string result = "result_" + std::to_string(i);
+
+			parse += "auto " + result + " = " + g.parse(p.get()) + ";\n"
+				"if (" + result + ".is_nothing())\n{\n\tb.rewind(start);\n\treturn " + g.nothing<R>() + ";\n}\n";
+			if (p->tag().length())
+				parse += "bound[" + generator::literal(p->tag()) + "] = " + result + ".from_just();\n";
+			parse += "\n";
+
+			recognize += "if (!" + g.recognize(p.get()) + ")\n{\n\tb.rewind(start);\n\treturn false;\n}\n\n";
+		}
+
+		parse += g.type<R>() + " final = " + m_callback + "(bound);\nreturn " + g.just<R>("final") + ";";
+		recognize += "return true;";
+
+		g.define<R, T>(parse, recognize);
+		return true;
+	}
+
+	// ******************************************************************
+	//! Strings and Characters
+	// ******************************************************************
+
+	inline bool string_parser::generate(generator& g) const
+	{
+		std::string value;
+		g.value(m_string, value);
+
+		std::string test = generator::text() + "if (!" + generator::text_is(m_string) + ")\n";
+		std::string advance = "\nb.advance(" + std::to_string(m_string.size()) + ");\n";
+
+		g.define<std::string, std::string>(
+			test + "\treturn " + g.nothing<std::string>() + ";\n" + advance + "return " + g.just<std::string>(value) + ";",
+			test + "\treturn false;\n" + advance + "return true;");
+		return true;
+	}
+
+	inline bool char_parser::generate(generator& g) const
+	{
+		g.define<char, std::string>(generator::text()
+			+ "if (o == d.size() || d[o] != " + generator::literal(m_char) + ")\n\treturn " + g.nothing<char>() + ";\n\n"
+			"b.advance(1);\nreturn " + g.just<char>(generator::literal(m_char)) + ";");
+		return true;
+	}
+
+	// ******************************************************************
+	//! Literals
+	// ******************************************************************
+
+	template<char... Cs>
+	bool literal_parser<Cs...>::generate(generator& g) const
+	{
+		std::string value;
+		g.value(std::string(text, size), value);
+
+		std::string test = generator::text() + "if (!" + generator::text_is(std::string(text, size)) + ")\n";
+		std::string advance = "\nb.advance(" + std::to_string(size) + ");\n";
+
+		g.define<std::string, std::string>(
+			test + "\treturn " + g.nothing<std::string>() + ";\n" + advance + "return " + g.just<std::string>(value) + ";",
+			test + "\treturn false;\n" + advance + "return true;");
+		return true;
+	}
+
+	//! One test per literal, in order, for the parse and recognize functions.
+	template<class L, class... Ls>
+	void literal_alternatives<L, Ls...>::generate(generator& g, std::string& parse, std::string& recognize)
+	{
+		std::string text(L::text, L::size), value;
+		g.value(text, value);
+
+		std::string test = "if (" + generator::text_is(text) + ")\n{\n\tb.advance(" + std::to_string(L::size) + ");\n\treturn ";
+		parse += test + g.just<std::string>(value) + ";\n}\n\n";
+		recognize += test + "true;\n}\n\n";
+
+		literal_alternatives<Ls...>::generate(g, parse, recognize);
+	}
+
+	template<class... Ls>
+	bool literal_choice_parser<Ls...>::generate(generator& g) const
+	{
+		std::string parse = generator::text(), recognize = generator::text();
+		alternatives::generate(g, parse, recognize);
+
+		g.define<std::string, std::string>(parse + "return " + g.nothing<std::string>() + ";", recognize + "return false;");
+		return true;
+	}
+
+	template<char... Bounds>
+	bool class_parser<Bounds...>::generate(generator& g) const
+	{
+		static const char bounds[] = { Bounds... };
+
+		std::string test;
+		for (std::size_t i = 0; i < sizeof(bounds); i += 2)
+		{
+			auto first = std::to_string(static_cast<unsigned char>(bounds[i]));
+			auto last = std::to_string(static_cast<unsigned char>(bounds[i + 1]));
+			test += (i ? " || " : "") + ("(c >= " + first + " && c <= " + last + ")");
+		}
+
+		g.define<char, std::string>(generator::text()
+			+ "if (o == d.size())\n\treturn " + g.nothing<char>() + ";\n\n"
+			"unsigned char c = d[o];\n"
+			"if (!(" + test + "))\n\treturn " + g.nothing<char>() + ";\n\n"
+			"b.advance(1);\nreturn " + g.just<char>("d[o]") + ";");
+		return true;
+	}
+
+	// ******************************************************************
+	//! Numbers
+	// ******************************************************************
+
+	//! Generated code uses a parser of its own, called directly.
+	template<typename T>
+	bool integer_parser<T>::generate(generator& g) const
+	{
+		g.define<T, std::string>("static const cpparse::detail::integer_parser<" + g.type<T>() + "> p("
+			+ (m_sign ? "true" : "false") + ", " + (m_hex ? "true" : "false") + ");\nreturn p.apply(b);");
+		return true;
+	}
+
+	template<typename T>
+	bool floating_parser<T>::generate(generator& g) const
+	{
+		g.define<T, std::string>("static const cpparse::detail::floating_parser<" + g.type<T>() + "> p;\nreturn p.apply(b);");
+		return true;
+	}
+
+	// ******************************************************************
+	//! Memo
+	// ******************************************************************
+
+	//! Generated code and images parse whole inputs, so the memo is left out.
+	template<typename R, typename T>
+	bool memo_parser<R, T>::generate(generator& g) const
+	{
+		g.define<R, T>("return " + g.parse(m_parser.get()) + ";", "return " + g.recognize(m_parser.get()) + ";");
+		return true;
+	}
+}
+}
@@ -0,0 +1,961 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <typeinfo>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+#include "dfa.h"
+#include "numeric.h"
+#include "image_format.h"
+#include "../maybe.h"
+#include "../buffer.h"
+#include "../context.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	//! A result inside a grammar image, where parsers have no C++ types.
+	/*! Text parsers give characters and text, numbers are kept as their
+	 *  64-bit pattern or as a long double, merges and repeats give text or
+	 *  lists, and whatever a callback returns is kept as an object. Values
+	 *  become C++ types again, with "image_traits", only when they are
+	 *  passed to a callback or returned.
+	 */
+	class image_value
+	{
+	public:
+		enum kind_type { empty, character, text, number, real, list, object };
+
+	public:
+		image_value()
+		: m_kind(empty), m_number(0), m_real(0), m_type(nullptr) {}
+
+		image_value(const image_value&) = default;
+		image_value(image_value&&) = default;
+		image_value& operator=(const image_value&) = default;
+		image_value& operator=(image_value&&) = default;
+		~image_value() = default;
+
+		static image_value of_char(char c)
+		{
+			image_value v(character);
+			v.m_number = static_cast<unsigned char>(c);
+			return v;
+		}
+
+		static image_value of_text(std::string s)
+		{
+			image_value v(text);
+			v.m_text = std::move(s);
+			return v;
+		}
+
+		static image_value of_number(std::uint64_t n)
+		{
+			image_value v(number);
+			v.m_number = n;
+			return v;
+		}
+
+		static image_value of_real(long double r)
+		{
+			image_value v(real);
+			v.m_real = r;
+			return v;
+		}
+
+		static image_value of_list() { return image_value(list); }
+
+		template<typename T>
+		static image_value of_object(const T& o)
+		{
+			image_value v(object);
+			v.m_object = std::make_shared<T>(o);
+			v.m_type = &typeid(T);
+			return v;
+		}
+
+		//! A shared pointer is kept as it is, with no copy of what it points to.
+		template<typename T>
+		static image_value of_pointer(const std::shared_ptr<T>& p)
+		{
+			image_value v(object);
+			v.m_object = p;
+			v.m_type = &typeid(std::shared_ptr<T>);
+			return v;
+		}
+
+		kind_type kind() const { return m_kind; }
+
+		char as_char() const { return static_cast<char>(m_number); }
+		std::uint64_t as_number() const { return m_number; }
+		long double as_real() const { return m_real; }
+
+		const std::string& as_text() const { return m_text; }
+		std::string& as_text() { return m_text; }
+
+		const std::vector<image_value>& as_list() const { return m_list; }
+		std::vector<image_value>& as_list() { return m_list; }
+
+		//! The object, if it is a "T". Otherwise throws std::logic_error.
+		template<typename T>
+		const T& as_object() const
+		{
+			check_type(typeid(T));
+			return *static_cast<const T*>(m_object.get());
+		}
+
+		template<typename T>
+		std::shared_ptr<T> as_pointer() const
+		{
+			check_type(typeid(std::shared_ptr<T>));
+			return std::static_pointer_cast<T>(m_object);
+		}
+
+		//! Add "v" to a merge or repeat; text collects characters and text, as "join" does.
+		void append(image_value&& v, bool as_text)
+		{
+			if (!as_text)
+				m_list.push_back(std::move(v));
+			else if (v.m_kind == character)
+				m_text += v.as_char();
+			else if (v.m_kind == text)
+				m_text += v.m_text;
+		}
+
+	private:
+		explicit image_value(kind_type k)
+		: m_kind(k), m_number(0), m_real(0), m_type(nullptr) {}
+
+		void check_type(const std::type_info& t) const
+		{
+			if (m_kind != object || *m_type != t)
+				throw std::logic_error("cpparse::grammar_image : A value is not of the type a callback expects!");
+		}
+
+	private:
+		kind_type m_kind;
+		std::uint64_t m_number;
+		long double m_real;
+		std::string m_text;
+		std::vector<image_value> m_list;
+		std::shared_ptr<void> m_object;
+		const std::type_info* m_type;
+	};
+
+	//! Convert between image values and C++ types. An empty value converts to "T()".
+	/*! Types other than characters, strings, numbers and vectors of those
+	 *  are kept as objects, which only convert back to the same type.
+	 */
+	template<typename T, typename Enable = void>
+	struct image_traits
+	{
+		static image_value from(const T& v) { return image_value::of_object(v); }
+		static T to(const image_value& v) { return (v.kind() == image_value::empty) ? T() : v.as_object<T>(); }
+	};
+
+	template<>
+	struct image_traits<std::string>
+	{
+		static image_value from(const std::string& v) { return image_value::of_text(v); }
+		static std::string to(const image_value& v)
+		{
+			if (v.kind() == image_value::character)
+				return std::string(1, v.as_char());
+
+			return (v.kind() == image_value::empty) ? std::string() : check(v).as_text();
+		}
+
+	private:
+		static const image_value& check(const image_value& v)
+		{
+			if (v.kind() != image_value::text)
+				throw std::logic_error("cpparse::grammar_image : A value is not of the type a callback expects!");
+
+			return v;
+		}
+	};
+
+	template<typename T>
+	struct image_traits<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>
+	{
+		static image_value from(const T& v) { return from(v, std::is_integral<T>()); }
+		static T to(const image_value& v)
+		{
+			switch (v.kind())
+			{
+			case image_value::empty:
+				return T();
+			case image_value::character:
+				return static_cast<T>(v.as_char());
+			case image_value::number:
+				return static_cast<T>(v.as_number());
+			case image_value::real:
+				return static_cast<T>(v.as_real());
+			default:
+				throw std::logic_error("cpparse::grammar_image : A value is not of the type a callback expects!");
+			}
+		}
+
+	private:
+		static image_value from(const T& v, std::true_type)
+		{
+			if (std::is_same<T, char>::value)
+				return image_value::of_char(static_cast<char>(v));
+
+			return image_value::of_number(static_cast<std::uint64_t>(v));
+		}
+
+		static image_value from(const T& v, std::false_type) { return image_value::of_real(v); }
+	};
+
+	template<typename T>
+	struct image_traits<std::shared_ptr<T>>
+	{
+		static image_value from(const std::shared_ptr<T>& v) { return image_value::of_pointer(v); }
+		static std::shared_ptr<T> to(const image_value& v) { return (v.kind() == image_value::empty) ? nullptr : v.as_pointer<T>(); }
+	};
+
+	template<typename T>
+	struct image_traits<std::vector<T>>
+	{
+		static image_value from(const std::vector<T>& v)
+		{
+			auto l = image_value::of_list();
+			for (auto& e : v)
+				l.as_list().push_back(image_traits<T>::from(e));
+
+			return l;
+		}
+
+		static std::vector<T> to(const image_value& v)
+		{
+			std::vector<T> result;
+			if (v.kind() == image_value::empty)
+				return result;
+
+			if (v.kind() != image_value::list)
+				throw std::logic_error("cpparse::grammar_image : A value is not of the type a callback expects!");
+
+			result.reserve(v.as_list().size());
+			for (auto& e : v.as_list())
+				result.push_back(image_traits<T>::to(e));
+
+			return result;
+		}
+	};
+
+	//! A function registered for a lift or a block in an image; only the one its parsers use is set.
+	struct image_callback
+	{
+		std::function<image_value(const image_value&)> lift;
+		std::function<image_value(const std::map<std::string, image_value>&)> block;
+	};
+
+	//! A checked grammar image, and the interpreter that parses with it.
+	/*! The image is used where it is, and never copied or turned back into
+	 *  parsers. Loading checks every node once, so a damaged image is
+	 *  rejected with std::runtime_error instead of being read out of bounds.
+	 */
+	class image_program
+	{
+	public:
+		typedef std::function<const image_callback*(const std::string&)> resolver;
+
+	public:
+		image_program(const void* data, std::size_t size, std::uint32_t version, const resolver& resolve)
+		: m_base(static_cast<const char*>(data)), m_nodes(nullptr), m_words(nullptr), m_bytes(nullptr)
+		{
+			if (reinterpret_cast<std::uintptr_t>(data) % 8)
+				fail("The image is not aligned to 8 bytes");
+
+			if (size < sizeof(image_header))
+				fail("The image is truncated");
+
+			std::memcpy(&m_header, data, sizeof(m_header));
+			if (std::memcmp(m_header.magic, image_magic, sizeof(image_magic)))
+				fail("The data is not a grammar image");
+
+			if (m_header.byte_order != 0x01020304)
+				fail("The image was saved with another byte order");
+
+			if (m_header.format != image_format_version)
+				fail("The image format " + std::to_string(m_header.format) + " is not supported, only " + std::to_string(image_format_version));
+
+			if (m_header.version != version)
+				fail("The grammar is version " + std::to_string(m_header.version) + ", not " + std::to_string(version));
+
+			if (m_header.size > size)
+				fail("The image is truncated");
+
+			m_nodes = reinterpret_cast<const image_node*>(region(m_header.nodes, m_header.node_count, sizeof(image_node)));
+			m_words = reinterpret_cast<const std::uint32_t*>(region(m_header.words, m_header.word_count, sizeof(std::uint32_t)));
+			m_bytes = region(m_header.bytes, m_header.byte_count, 1);
+
+			auto names = reinterpret_cast<const std::uint32_t*>(region(m_header.callbacks, m_header.callback_count, 2 * sizeof(std::uint32_t)));
+			for (std::uint32_t i = 0; i < m_header.callback_count; ++i)
+			{
+				check_bytes(names[2 * i], names[2 * i + 1]);
+
+				std::string name(m_bytes + names[2 * i], names[2 * i + 1]);
+				auto callback = resolve(name);
+				if (!callback)
+					fail("No callback is registered as \"" + name + "\"");
+
+				m_callbacks.push_back(callback);
+				m_names.push_back(name);
+			}
+
+			if (m_header.root >= m_header.node_count)
+				fail("The root is not a node");
+
+			for (std::uint32_t i = 0; i < m_header.node_count; ++i)
+				check_node(m_nodes[i]);
+
+			check_cycles();
+		}
+
+		image_program(const image_program&) = default;
+		~image_program() = default;
+
+		std::uint32_t root() const { return m_header.root; }
+		std::size_t nodes() const { return m_header.node_count; }
+
+		bool parse(std::uint32_t i, buffer<std::string>& b, image_value& out) const
+		{
+			if (auto context = b.context())
+				context->step();
+
+			auto& n = m_nodes[i];
+			switch (n.op)
+			{
+			case op_char:
+			case op_set:
+			{
+				auto o = b.offset();
+				if (match(n, b) < 0)
+					return false;
+
+				out = image_value::of_char(b.data()[o]);
+				return true;
+			}
+
+			case op_text:
+			case op_texts:
+			case op_dfa:
+			{
+				auto o = b.offset();
+				auto length = match(n, b);
+				if (length < 0)
+					return false;
+
+				out = image_value::of_text(b.data().substr(o, length));
+				return true;
+			}
+
+			case op_choice:
+				return parse(n.a, b, out) || parse(n.b, b, out);
+
+			case op_sequence:
+			{
+				auto start = b.here();
+				image_value ignored;
+				if (!parse(n.a, b, ignored))
+					return false;
+
+				if (parse(n.b, b, out))
+					return true;
+
+				b.rewind(start);
+				return false;
+			}
+
+			case op_merge:
+			{
+				auto start = b.here();
+				image_value first, second;
+				if (!parse(n.a, b, first))
+					return false;
+
+				if (!parse(n.b, b, second))
+				{
+					b.rewind(start);
+					return false;
+				}
+
+				bool as_text = (n.mode == accumulate_text);
+				out = as_text ? image_value::of_text(std::string()) : image_value::of_list();
+				out.append(std::move(first), as_text);
+				out.append(std::move(second), as_text);
+				return true;
+			}
+
+			case op_many:
+			{
+				auto start = b.here();
+				bool as_text = (n.mode == accumulate_text);
+				image_value accum = as_text ? image_value::of_text(std::string()) : image_value::of_list();
+
+				std::uint32_t i = 0;
+				image_value next;
+				while ((!n.c || i < n.c) && parse(n.a, b, next))
+				{
+					i += 1;
+					accum.append(std::move(next), as_text);
+				}
+
+				if (i < n.b)
+				{
+					b.rewind(start);
+					return false;
+				}
+
+				out = std::move(accum);
+				return true;
+			}
+
+			case op_block:
+			{
+				auto start = b.here();
+				std::map<std::string, image_value> bound;
+				for (std::uint32_t s = 0; s < n.b; ++s)
+				{
+					auto statement = m_words + n.a + 3 * s;
+
+					image_value result;
+					if (!parse(statement[0], b, result))
+					{
+						b.rewind(start);
+						return false;
+					}
+
+					if (statement[2])
+						bound[std::string(m_bytes + statement[1], statement[2])] = std::move(result);
+				}
+
+				out = m_callbacks[n.c]->block(bound);
+				return true;
+			}
+
+			case op_lift:
+			{
+				image_value to_lift;
+				if (!parse(n.a, b, to_lift))
+					return false;
+
+				out = m_callbacks[n.c]->lift(to_lift);
+				return true;
+			}
+
+			case op_forward:
+			{
+				depth_guard guard(b.context());
+				return parse(n.a, b, out);
+			}
+
+			case op_skip:
+			{
+				image_value ignored;
+				if (!parse(n.a, b, ignored))
+					return false;
+
+				out = image_value();
+				return true;
+			}
+
+			case op_lookahead:
+				if (!recognize(i, b))
+					return false;
+
+				out = image_value();
+				return true;
+
+			case op_option:
+				if (!parse(n.a, b, out))
+					out = constant(n);
+
+				return true;
+
+			case op_commit:
+			{
+				auto start = b.offset();
+				cut_guard<buffer<std::string>> cut(b, start);
+
+				if (!parse(n.a, b, out))
+					throw commit_failed(start);
+
+				return true;
+			}
+
+			case op_integer:
+				return parse_integer(n, b, out);
+
+			case op_floating:
+				return parse_floating(n, b, out);
+			}
+
+			return false;
+		}
+
+		bool recognize(std::uint32_t i, buffer<std::string>& b) const
+		{
+			if (auto context = b.context())
+				context->step();
+
+			auto& n = m_nodes[i];
+			switch (n.op)
+			{
+			case op_char:
+			case op_set:
+			case op_text:
+			case op_texts:
+			case op_dfa:
+				return match(n, b) >= 0;
+
+			case op_choice:
+				return recognize(n.a, b) || recognize(n.b, b);
+
+			case op_sequence:
+			case op_merge:
+			{
+				auto start = b.here();
+				if (!recognize(n.a, b))
+					return false;
+
+				if (recognize(n.b, b))
+					return true;
+
+				b.rewind(start);
+				return false;
+			}
+
+			case op_many:
+			{
+				auto start = b.here();
+
+				std::uint32_t i = 0;
+				while ((!n.c || i < n.c) && recognize(n.a, b))
+					i += 1;
+
+				if (i < n.b)
+				{
+					b.rewind(start);
+					return false;
+				}
+
+				return true;
+			}
+
+			case op_block:
+			{
+				auto start = b.here();
+				for (std::uint32_t s = 0; s < n.b; ++s)
+				{
+					if (!recognize(m_words[n.a + 3 * s], b))
+					{
+						b.rewind(start);
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+			case op_forward:
+			{
+				depth_guard guard(b.context());
+				return recognize(n.a, b);
+			}
+
+			case op_lift:
+			case op_skip:
+				return recognize(n.a, b);
+
+			case op_lookahead:
+			{
+				auto start = b.here();
+				bool matched = recognize(n.a, b);
+				if (matched)
+					b.rewind(start);
+
+				return (matched != (n.mode != 0));
+			}
+
+			case op_option:
+				recognize(n.a, b);
+				return true;
+
+			case op_commit:
+			{
+				auto start = b.offset();
+				cut_guard<buffer<std::string>> cut(b, start);
+
+				if (!recognize(n.a, b))
+					throw commit_failed(start);
+
+				return true;
+			}
+
+			case op_integer:
+			case op_floating:
+			{
+				image_value ignored;
+				return parse(i, b, ignored);
+			}
+			}
+
+			return false;
+		}
+
+	private:
+		static void fail(const std::string& message)
+		{
+			throw std::runtime_error("cpparse::grammar_image : " + message + "!");
+		}
+
+		//! The start of "count" elements of "size" bytes at "offset", after checking they are within the image.
+		const char* region(std::uint32_t offset, std::uint32_t count, std::size_t size) const
+		{
+			if (offset % 4 || offset < sizeof(image_header) || offset > m_header.size
+				|| static_cast<std::uint64_t>(count) * size > m_header.size - offset)
+				fail("A section of the image is out of bounds");
+
+			return m_base + offset;
+		}
+
+		void check_bytes(std::uint64_t offset, std::uint64_t size) const
+		{
+			if (offset + size > m_header.byte_count)
+				fail("Text in the image is out of bounds");
+		}
+
+		void check_child(std::uint32_t i) const
+		{
+			if (i >= m_header.node_count)
+				fail("A parser refers to a node that does not exist");
+		}
+
+		void check_callback(std::uint32_t i, bool block) const
+		{
+			if (i >= m_callbacks.size())
+				fail("A parser refers to a callback that does not exist");
+
+			if (block ? !m_callbacks[i]->block : !m_callbacks[i]->lift)
+				fail("The callback \"" + m_names[i] + "\" is not registered for a " + (block ? "block" : "lift"));
+		}
+
+		void check_node(const image_node& n) const
+		{
+			switch (n.op)
+			{
+			case op_char:
+				if (n.a > 255)
+					fail("A character is out of range");
+				break;
+
+			case op_text:
+				check_bytes(n.a, n.b);
+				break;
+
+			case op_set:
+				if (n.a % 4)
+					fail("A character set is not aligned");
+				check_bytes(n.a, 32);
+				break;
+
+			case op_texts:
+				if (static_cast<std::uint64_t>(n.a) + 2 * static_cast<std::uint64_t>(n.b) > m_header.word_count)
+					fail("A list of literals is out of bounds");
+				for (std::uint32_t i = 0; i < n.b; ++i)
+					check_bytes(m_words[n.a + 2 * i], m_words[n.a + 2 * i + 1]);
+				break;
+
+			case op_choice:
+			case op_sequence:
+				check_child(n.a);
+				check_child(n.b);
+				break;
+
+			case op_merge:
+				check_child(n.a);
+				check_child(n.b);
+				if (n.mode > accumulate_text)
+					fail("A merge has an unknown mode");
+				break;
+
+			case op_many:
+				check_child(n.a);
+				if (n.mode > accumulate_text)
+					fail("A repeat has an unknown mode");
+				break;
+
+			case op_block:
+				if (static_cast<std::uint64_t>(n.a) + 3 * static_cast<std::uint64_t>(n.b) > m_header.word_count)
+					fail("A block is out of bounds");
+				for (std::uint32_t i = 0; i < n.b; ++i)
+				{
+					check_child(m_words[n.a + 3 * i]);
+					check_bytes(m_words[n.a + 3 * i + 1], m_words[n.a + 3 * i + 2]);
+				}
+				check_callback(n.c, true);
+				break;
+
+			case op_lift:
+				check_child(n.a);
+				check_callback(n.c, false);
+				break;
+
+			case op_forward:
+			case op_skip:
+			case op_lookahead:
+			case op_commit:
+				check_child(n.a);
+				break;
+
+			case op_option:
+				check_child(n.a);
+				if (n.mode > constant_real)
+					fail("An option has an unknown value");
+				if (n.mode == constant_text)
+					check_bytes(n.b, n.c);
+				break;
+
+			case op_integer:
+				if (n.mode != 1 && n.mode != 2 && n.mode != 4 && n.mode != 8)
+					fail("An integer has an unsupported size");
+				break;
+
+			case op_floating:
+				if (n.mode > 2)
+					fail("A floating point number has an unknown type");
+				break;
+
+			case op_dfa:
+				if (n.a % 4)
+					fail("An automaton is not aligned");
+				check_bytes(n.a, n.b);
+				if (!dfa::valid_image(m_bytes + n.a, n.b))
+					fail("An automaton is damaged");
+				break;
+
+			default:
+				fail("A parser has an unknown type");
+			}
+		}
+
+		//! Parsers call each other directly except through placeholders, so any other cycle would never end.
+		void check_cycles() const
+		{
+			enum { unseen, open, done };
+			std::vector<std::uint8_t> state(m_header.node_count, unseen);
+			std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+
+			for (std::uint32_t root = 0; root < m_header.node_count; ++root)
+			{
+				if (state[root] != unseen)
+					continue;
+
+				state[root] = open;
+				stack.push_back(std::make_pair(root, 0u));
+				while (!stack.empty())
+				{
+					auto& top = stack.back();
+					std::uint32_t child;
+					if (!next_child(top.first, top.second++, child))
+					{
+						state[top.first] = done;
+						stack.pop_back();
+					}
+					else if (state[child] == open)
+						fail("The image has a cycle that does not pass through a placeholder");
+					else if (state[child] == unseen)
+					{
+						state[child] = open;
+						stack.push_back(std::make_pair(child, 0u));
+					}
+				}
+			}
+		}
+
+		//! The "k"th node "i" calls without a placeholder in between.
+		bool next_child(std::uint32_t i, std::uint32_t k, std::uint32_t& child) const
+		{
+			auto& n = m_nodes[i];
+			switch (n.op)
+			{
+			case op_choice:
+			case op_sequence:
+			case op_merge:
+				child = k ? n.b : n.a;
+				return k < 2;
+
+			case op_many:
+			case op_lift:
+			case op_skip:
+			case op_lookahead:
+			case op_option:
+			case op_commit:
+				child = n.a;
+				return k < 1;
+
+			case op_block:
+				child = (k < n.b) ? m_words[n.a + 3 * k] : 0;
+				return k < n.b;
+
+			default:
+				return false;
+			}
+		}
+
+		//! The length of the text at the buffer a text parser matches, or -1. The buffer is moved past it.
+		std::ptrdiff_t match(const image_node& n, buffer<std::string>& b) const
+		{
+			auto& d = b.data();
+			auto o = b.offset();
+			const char* p = d.data() + o;
+			std::size_t left = d.size() - o;
+
+			std::ptrdiff_t length = -1;
+			switch (n.op)
+			{
+			case op_char:
+				if (left && static_cast<unsigned char>(*p) == n.a)
+					length = 1;
+				break;
+
+			case op_set:
+			{
+				auto set = reinterpret_cast<const std::uint32_t*>(m_bytes + n.a);
+				auto c = static_cast<unsigned char>(*p);
+				if (left && ((set[c >> 5] >> (c & 31)) & 1))
+					length = 1;
+				break;
+			}
+
+			case op_text:
+				if (left >= n.b && !std::memcmp(p, m_bytes + n.a, n.b))
+					length = n.b;
+				break;
+
+			case op_texts:
+				for (std::uint32_t i = 0; i < n.b && length < 0; ++i)
+				{
+					auto size = m_words[n.a + 2 * i + 1];
+					if (left >= size && !std::memcmp(p, m_bytes + m_words[n.a + 2 * i], size))
+						length = size;
+				}
+				break;
+
+			case op_dfa:
+				length = dfa::match_image(m_bytes + n.a, p, p + left);
+				break;
+			}
+
+			if (length >= 0)
+				b.advance(length);
+
+			return length;
+		}
+
+		image_value constant(const image_node& n) const
+		{
+			switch (n.mode)
+			{
+			case constant_char:
+				return image_value::of_char(static_cast<char>(n.b));
+			case constant_text:
+				return image_value::of_text(std::string(m_bytes + n.b, n.c));
+			case constant_number:
+				return image_value::of_number((static_cast<std::uint64_t>(n.c) << 32) | n.b);
+			case constant_real:
+			{
+				std::uint64_t bits = (static_cast<std::uint64_t>(n.c) << 32) | n.b;
+				double d;
+				std::memcpy(&d, &bits, sizeof(d));
+				return image_value::of_real(d);
+			}
+			default:
+				return image_value();
+			}
+		}
+
+		//! Numbers use the library's own parsers, one for each combination of flags.
+		template<typename T>
+		static bool parse_integer(std::uint16_t flags, buffer<std::string>& b, image_value& out)
+		{
+			static const integer_parser<T> parsers[4] = {
+				integer_parser<T>(false, false), integer_parser<T>(true, false),
+				integer_parser<T>(false, true), integer_parser<T>(true, true)
+			};
+
+			auto result = parsers[flags & (integer_sign | integer_hex)].apply(b);
+			if (result.is_nothing())
+				return false;
+
+			out = image_value::of_number(static_cast<std::uint64_t>(result.from_just()));
+			return true;
+		}
+
+		static bool parse_integer(const image_node& n, buffer<std::string>& b, image_value& out)
+		{
+			bool is_signed = (n.flags & integer_signed) != 0;
+			switch (n.mode)
+			{
+			case 1:
+				return is_signed ? parse_integer<std::int8_t>(n.flags, b, out) : parse_integer<std::uint8_t>(n.flags, b, out);
+			case 2:
+				return is_signed ? parse_integer<std::int16_t>(n.flags, b, out) : parse_integer<std::uint16_t>(n.flags, b, out);
+			case 4:
+				return is_signed ? parse_integer<std::int32_t>(n.flags, b, out) : parse_integer<std::uint32_t>(n.flags, b, out);
+			default:
+				return is_signed ? parse_integer<std::int64_t>(n.flags, b, out) : parse_integer<std::uint64_t>(n.flags, b, out);
+			}
+		}
+
+		template<typename T>
+		static bool parse_floating(buffer<std::string>& b, image_value& out)
+		{
+			static const floating_parser<T> parser;
+
+			auto result = parser.apply(b);
+			if (result.is_nothing())
+				return false;
+
+			out = image_value::of_real(result.from_just());
+			return true;
+		}
+
+		static bool parse_floating(const image_node& n, buffer<std::string>& b, image_value& out)
+		{
+			switch (n.mode)
+			{
+			case 0:
+				return parse_floating<float>(b, out);
+			case 1:
+				return parse_floating<double>(b, out);
+			default:
+				return parse_floating<long double>(b, out);
+			}
+		}
+
+	private:
+		const char* m_base;
+		image_header m_header;
+
+		const image_node* m_nodes;
+		const std::uint32_t* m_words;
+		const char* m_bytes;
+
+		std::vector<const image_callback*> m_callbacks;
+		std::vector<std::string> m_names;
+	};
+}
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <map>
+#include <bitset>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace cpparse
+{
+namespace detail
+{
+	class parser_node;
+
+	//! The layout of a grammar image, written by "save_image" and read by "grammar_image".
+	/*! An image is a header followed by three regions: an array of nodes, an
+	 *  array of 32-bit words (lists such as block statements) and raw bytes
+	 *  (text, character sets and automata). Everything refers to everything
+	 *  else by index or by offset into a region, never by address, so an
+	 *  image can be used wherever it is mapped.
+	 */
+	struct image_header
+	{
+		char magic[8];
+		//! 0x01020304 as the writer stored it, to reject images from a machine of the other byte order.
+		std::uint32_t byte_order;
+		std::uint32_t format;
+		//! The grammar's own version, given to "save_image".
+		std::uint32_t version;
+		std::uint32_t root;
+		std::uint32_t size;
+
+		std::uint32_t nodes, node_count;
+		std::uint32_t words, word_count;
+		std::uint32_t bytes, byte_count;
+		//! Pairs of (offset, length) in "bytes", one per callback name.
+		std::uint32_t callbacks, callback_count;
+		std::uint32_t reserved;
+	};
+
+	//! One parser. What "a", "b" and "c" hold depends on "op"; see the comments on each op.
+	struct image_node
+	{
+		std::uint8_t op;
+		std::uint8_t mode;
+		std::uint16_t flags;
+		std::uint32_t a, b, c;
+	};
+
+	//! Increased whenever the layout or the meaning of a field changes.
+	const std::uint32_t image_format_version = 1;
+	const char image_magic[8] = { 'c', 'p', 'p', 'a', 'r', 's', 'e', '\0' };
+
+	enum image_op : std::uint8_t
+	{
+		op_char,        //!< a: the character
+		op_text,        //!< a, b: offset and length of the text
+		op_set,         //!< a: offset of a 256-bit set; returns the character
+		op_texts,       //!< a, b: offset and count of (offset, length) word pairs, tried in order
+		op_choice,      //!< a, b: the alternatives
+		op_sequence,    //!< a, b: returns the result of "b"
+		op_merge,       //!< a, b; mode: an image_accumulate
+		op_many,        //!< a: the parser, b: min, c: max (0 for no limit); mode: an image_accumulate
+		op_block,       //!< a, b: offset and count of (node, tag offset, tag length) word triples, c: callback
+		op_lift,        //!< a: the parser, c: callback
+		op_forward,     //!< a: the target
+		op_skip,        //!< a: the parser
+		op_lookahead,   //!< a: the parser; mode: 1 if negative
+		op_option,      //!< a: the parser; mode: an image_constant, b and c its value
+		op_commit,      //!< a: the parser
+		op_integer,     //!< mode: size of the type; flags: image_integer_flags
+		op_floating,    //!< mode: 0 for float, 1 for double, 2 for long double
+		op_dfa,         //!< a, b: offset and size of the automaton, see "dfa::write"
+		op_count
+	};
+
+	//! How results are combined by merges and "many": as with "join", chars and strings make a string.
+	enum image_accumulate : std::uint8_t { accumulate_list, accumulate_text };
+
+	enum image_integer_flags : std::uint16_t { integer_sign = 1, integer_hex = 2, integer_signed = 4 };
+
+	//! The kinds of value an option's alternate can be stored as.
+	enum image_constant : std::uint8_t { constant_empty, constant_char, constant_text, constant_number, constant_real };
+
+	//! Only parsers of text can be saved.
+	template<typename T>
+	struct image_input : std::is_same<T, std::string> {};
+
+	//! Collects a grammar into an image, for "save_image".
+	/*! A parser adds itself from "parser_node::save" with "emit", after
+	 *  asking for the indices of the parsers it contains with "node".
+	 */
+	class image_writer
+	{
+	public:
+		image_writer()
+		: m_current(0) {}
+
+		image_writer(const image_writer&) = delete;
+		~image_writer() = default;
+
+		//! The index of "n" in the image. It will be saved if it has not been yet.
+		std::uint32_t node(const parser_node* n)
+		{
+			auto found = m_ids.find(n);
+			if (found == m_ids.end())
+			{
+				found = m_ids.insert(std::make_pair(n, static_cast<std::uint32_t>(m_ids.size()))).first;
+				m_pending.push_back(n);
+				m_nodes.push_back(image_node());
+			}
+
+			return found->second;
+		}
+
+		//! The next parser waiting to be saved, if any.
+		bool take(const parser_node*& n)
+		{
+			if (m_pending.empty())
+				return false;
+
+			n = m_pending.back();
+			m_pending.pop_back();
+			m_current = m_ids[n];
+			return true;
+		}
+
+		//! Called from "parser_node::save" with the fields of the parser's node.
+		void emit(image_op op, std::uint8_t mode, std::uint16_t flags, std::uint32_t a = 0, std::uint32_t b = 0, std::uint32_t c = 0)
+		{
+			image_node n = { static_cast<std::uint8_t>(op), mode, flags, a, b, c };
+			m_nodes[m_current] = n;
+		}
+
+		//! Store bytes, returning their offset. Offsets are aligned to 4 bytes.
+		std::uint32_t bytes(const void* data, std::size_t size)
+		{
+			while (m_bytes.size() % 4)
+				m_bytes.push_back('\0');
+
+			auto offset = static_cast<std::uint32_t>(m_bytes.size());
+			m_bytes.append(static_cast<const char*>(data), size);
+			return offset;
+		}
+
+		std::uint32_t text(const std::string& s) { return bytes(s.data(), s.size()); }
+
+		std::uint32_t set(const std::bitset<256>& chars)
+		{
+			std::uint32_t words[8] = {};
+			for (unsigned c = 0; c < 256; ++c)
+				if (chars[c])
+					words[c >> 5] |= std::uint32_t(1) << (c & 31);
+
+			return bytes(words, sizeof(words));
+		}
+
+		//! Store a list of words, returning the index of the first.
+		std::uint32_t words(const std::vector<std::uint32_t>& w)
+		{
+			auto offset = static_cast<std::uint32_t>(m_words.size());
+			m_words.insert(m_words.end(), w.begin(), w.end());
+			return offset;
+		}
+
+		//! The index of a callback name; each name is stored once.
+		std::uint32_t callback(const std::string& name)
+		{
+			auto found = m_callbacks.find(name);
+			if (found == m_callbacks.end())
+			{
+				found = m_callbacks.insert(std::make_pair(name, static_cast<std::uint32_t>(m_callback_names.size()))).first;
+				m_callback_names.push_back(name);
+			}
+
+			return found->second;
+		}
+
+		//! Store an option's alternate value in "mode", "b" and "c". False if it cannot be stored.
+		bool constant(const std::string& v, std::uint8_t& mode, std::uint32_t& b, std::uint32_t& c)
+		{
+			mode = constant_text;
+			b = text(v);
+			c = static_cast<std::uint32_t>(v.size());
+			return true;
+		}
+
+		bool constant(char v, std::uint8_t& mode, std::uint32_t& b, std::uint32_t&)
+		{
+			mode = constant_char;
+			b = static_cast<unsigned char>(v);
+			return true;
+		}
+
+		template<typename R>
+		bool constant(const std::vector<R>& v, std::uint8_t& mode, std::uint32_t&, std::uint32_t&)
+		{
+			mode = constant_empty;
+			return v.empty();
+		}
+
+		template<typename R>
+		bool constant(const std::shared_ptr<R>& v, std::uint8_t& mode, std::uint32_t&, std::uint32_t&)
+		{
+			mode = constant_empty;
+			return !v;
+		}
+
+		template<typename R>
+		bool constant(const R& v, std::uint8_t& mode, std::uint32_t& b, std::uint32_t& c)
+		{
+			return number_constant(v, mode, b, c, typename std::is_integral<R>::type(), typename std::is_floating_point<R>::type());
+		}
+
+		//! The finished image.
+		std::string finish(std::uint32_t root, std::uint32_t version)
+		{
+			std::vector<std::uint32_t> names;
+			for (auto& n : m_callback_names)
+			{
+				names.push_back(text(n));
+				names.push_back(static_cast<std::uint32_t>(n.size()));
+			}
+
+			image_header h;
+			std::memset(&h, 0, sizeof(h));
+			std::memcpy(h.magic, image_magic, sizeof(h.magic));
+			h.byte_order = 0x01020304;
+			h.format = image_format_version;
+			h.version = version;
+			h.root = root;
+
+			std::string image(sizeof(h), '\0');
+			auto append = [&image](const void* data, std::size_t size, std::uint32_t& offset)
+			{
+				while (image.size() % 16)
+					image.push_back('\0');
+
+				offset = static_cast<std::uint32_t>(image.size());
+				image.append(static_cast<const char*>(data), size);
+			};
+
+			append(m_nodes.data(), m_nodes.size() * sizeof(image_node), h.nodes);
+			append(m_words.data(), m_words.size() * sizeof(std::uint32_t), h.words);
+			append(names.data(), names.size() * sizeof(std::uint32_t), h.callbacks);
+			append(m_bytes.data(), m_bytes.size(), h.bytes);
+
+			h.node_count = static_cast<std::uint32_t>(m_nodes.size());
+			h.word_count = static_cast<std::uint32_t>(m_words.size());
+			h.byte_count = static_cast<std::uint32_t>(m_bytes.size());
+			h.callback_count = static_cast<std::uint32_t>(m_callback_names.size());
+			h.size = static_cast<std::uint32_t>(image.size());
+
+			std::memcpy(&image[0], &h, sizeof(h));
+			return image;
+		}
+
+	private:
+		template<typename R>
+		bool number_constant(const R& v, std::uint8_t& mode, std::uint32_t& b, std::uint32_t& c, std::true_type, std::false_type)
+		{
+			auto bits = static_cast<std::uint64_t>(v);
+			mode = constant_number;
+			b = static_cast<std::uint32_t>(bits);
+			c = static_cast<std::uint32_t>(bits >> 32);
+			return true;
+		}
+
+		//! Stored as a double, so only values a double holds exactly.
+		template<typename R>
+		bool number_constant(const R& v, std::uint8_t& mode, std::uint32_t& b, std::uint32_t& c, std::false_type, std::true_type)
+		{
+			double d = static_cast<double>(v);
+			std::uint64_t bits;
+			std::memcpy(&bits, &d, sizeof(bits));
+
+			mode = constant_real;
+			b = static_cast<std::uint32_t>(bits);
+			c = static_cast<std::uint32_t>(bits >> 32);
+			return static_cast<R>(d) == v;
+		}
+
+		template<typename R, typename I, typename F>
+		bool number_constant(const R&, std::uint8_t&, std::uint32_t&, std::uint32_t&, I, F) { return false; }
+
+	private:
+		std::map<const parser_node*, std::uint32_t> m_ids;
+		std::vector<const parser_node*> m_pending;
+		std::uint32_t m_current;
+
+		std::vector<image_node> m_nodes;
+		std::vector<std::uint32_t> m_words;
+		std::string m_bytes;
+
+		std::map<std::string, std::uint32_t> m_callbacks;
+		std::vector<std::string> m_callback_names;
+	};
+}
+}
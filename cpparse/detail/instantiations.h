@@ -0,0 +1,50 @@
+// No include guard: this list is expanded twice, by "precompiled.h" and by src/instantiations.cpp.
+
+//! The parsers and combinators of characters and strings that most grammars are made of.
+/*! Each entry is passed to CPPARSE_INSTANTIATE, which the includer defines. */
+CPPARSE_INSTANTIATE(cpparse::maybe<char>)
+CPPARSE_INSTANTIATE(cpparse::maybe<std::string>)
+CPPARSE_INSTANTIATE(cpparse::maybe<std::vector<std::string>>)
+CPPARSE_INSTANTIATE(cpparse::buffer<std::string>)
+CPPARSE_INSTANTIATE(cpparse::accumulator<char>)
+CPPARSE_INSTANTIATE(cpparse::accumulator<std::string>)
+
+CPPARSE_INSTANTIATE(cpparse::detail::parser<char, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::parser<std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::parser<std::vector<std::string>, std::string>)
+
+CPPARSE_INSTANTIATE(cpparse::detail::forward_parser<char, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::forward_parser<std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::skip_parser<std::string, char>)
+CPPARSE_INSTANTIATE(cpparse::detail::skip_parser<std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::lookahead_parser<std::string, std::string, char>)
+CPPARSE_INSTANTIATE(cpparse::detail::lookahead_parser<std::string, std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::option_parser<char, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::option_parser<std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::commit_parser<char, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::commit_parser<std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::lift_parser<std::string, std::string, char>)
+CPPARSE_INSTANTIATE(cpparse::detail::lift_parser<std::vector<std::string>, std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::oneof_parser<char, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::noneof_parser<char, std::string>)
+
+CPPARSE_INSTANTIATE(cpparse::detail::choice_combinator<char, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::choice_combinator<std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::sequence_combinator<char, std::string, char>)
+CPPARSE_INSTANTIATE(cpparse::detail::sequence_combinator<char, std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::sequence_combinator<std::string, std::string, char>)
+CPPARSE_INSTANTIATE(cpparse::detail::sequence_combinator<std::string, std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::merge_combinator<char, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::merge_combinator<std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::many_combinator<char, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::many_combinator<std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::block_combinator<std::string, std::string, std::string>)
+CPPARSE_INSTANTIATE(cpparse::detail::block_combinator<std::vector<std::string>, std::string, std::vector<std::string>>)
+
+CPPARSE_INSTANTIATE(cpparse::detail::integer_parser<int>)
+CPPARSE_INSTANTIATE(cpparse::detail::integer_parser<long>)
+CPPARSE_INSTANTIATE(cpparse::detail::integer_parser<long long>)
+CPPARSE_INSTANTIATE(cpparse::detail::integer_parser<unsigned>)
+CPPARSE_INSTANTIATE(cpparse::detail::integer_parser<unsigned long>)
+CPPARSE_INSTANTIATE(cpparse::detail::floating_parser<float>)
+CPPARSE_INSTANTIATE(cpparse::detail::floating_parser<double>)
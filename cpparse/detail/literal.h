@@ -0,0 +1,320 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "parser.h"
+#include "../maybe.h"
+#include "../buffer.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	// ******************************************************************
+	//! Literals - text fixed at compile time.
+	// ******************************************************************
+
+	//! Compare characters to "Cs", one comparison per character, with no loop.
+	template<char... Cs>
+	struct literal_chars;
+
+	template<>
+	struct literal_chars<>
+	{
+		static bool match(const char*) { return true; }
+	};
+
+	template<char C, char... Cs>
+	struct literal_chars<C, Cs...>
+	{
+		static bool match(const char* p) { return *p == C && literal_chars<Cs...>::match(p + 1); }
+	};
+
+	//! Parse the characters "Cs" in order, returning them as a string.
+	template<char... Cs>
+	class literal_parser : public parser<std::string, std::string>
+	{
+		static_assert(sizeof...(Cs) > 0, "cpparse::lit : A literal needs at least one character!");
+
+	public:
+		static constexpr std::size_t size = sizeof...(Cs);
+		static constexpr char text[sizeof...(Cs) + 1] = { Cs..., '\0' };
+
+	public:
+		literal_parser()
+		: parser<std::string, std::string>() {}
+
+		literal_parser(const literal_parser&) = default;
+		~literal_parser() = default;
+
+		const char* kind() const { return "literal"; }
+		std::string expected() const { return quote(std::string(text, size)); }
+
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<std::string> apply(buffer<std::string>& buffer) const
+		{
+			if (!match(buffer))
+				return maybe<std::string>::nothing;
+
+			return maybe<std::string>::just(std::string(text, size));
+		}
+
+		bool do_recognize(buffer<std::string>& buffer) const { return match(buffer); }
+
+		//! True if the "n" characters at "p" start with the literal.
+		static bool matches(const char* p, std::size_t n) { return n >= size && literal_chars<Cs...>::match(p); }
+
+	private:
+		//! A failed comparison looked at up to "size" characters, or found the end before then.
+		static bool match(buffer<std::string>& buffer)
+		{
+			auto& data = buffer.data();
+			if (!matches(data.data() + buffer.offset(), data.size() - buffer.offset()))
+			{
+				buffer.examine(buffer.offset() + size);
+				return false;
+			}
+
+			buffer.advance(size);
+			return true;
+		}
+	};
+
+	template<char... Cs>
+	constexpr std::size_t literal_parser<Cs...>::size;
+
+	template<char... Cs>
+	constexpr char literal_parser<Cs...>::text[sizeof...(Cs) + 1];
+
+	//! Try literals in order, in one function, stopping at the first that matches.
+	template<class... Ls>
+	struct literal_alternatives;
+
+	template<>
+	struct literal_alternatives<>
+	{
+		static bool match(const char*, std::size_t, const char*&, std::size_t&) { return false; }
+		static constexpr std::size_t longest() { return 0; }
+		static void describe(std::vector<std::string>&) {}
+		static int regular(regular_expression&) { return -1; }
+		static void generate(generator&, std::string&, std::string&) {}
+		static void save(image_writer&, std::vector<std::uint32_t>&) {}
+	};
+
+	template<class L, class... Ls>
+	struct literal_alternatives<L, Ls...>
+	{
+		static bool match(const char* p, std::size_t n, const char*& text, std::size_t& size)
+		{
+			if (!L::matches(p, n))
+				return literal_alternatives<Ls...>::match(p, n, text, size);
+
+			text = L::text;
+			size = L::size;
+			return true;
+		}
+
+		static constexpr std::size_t longest() { return L::size > literal_alternatives<Ls...>::longest() ? L::size : literal_alternatives<Ls...>::longest(); }
+
+		static void describe(std::vector<std::string>& d)
+		{
+			d.push_back(quote(std::string(L::text, L::size)));
+			literal_alternatives<Ls...>::describe(d);
+		}
+
+		static int regular(regular_expression& r);
+		static void generate(generator& g, std::string& parse, std::string& recognize);
+		static void save(image_writer& w, std::vector<std::uint32_t>& texts);
+	};
+
+	//! A choice between literals, made by "|". Behaves like the choice_combinator.
+	/*! Every alternative is known from the type, so they are all compared
+	 *  in this one call, instead of one parser call each.
+	 */
+	template<class... Ls>
+	class literal_choice_parser : public parser<std::string, std::string>
+	{
+	private:
+		typedef literal_alternatives<Ls...> alternatives;
+
+	public:
+		literal_choice_parser()
+		: parser<std::string, std::string>() {}
+
+		literal_choice_parser(const literal_choice_parser&) = default;
+		~literal_choice_parser() = default;
+
+		const char* kind() const { return "literal_choice"; }
+		std::string expected() const
+		{
+			std::vector<std::string> d;
+			alternatives::describe(d);
+
+			std::string joined;
+			for (std::size_t i = 0; i < d.size(); ++i)
+				joined += (i ? (i + 1 == d.size() ? " or " : ", ") : "") + d[i];
+
+			return joined;
+		}
+
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<std::string> apply(buffer<std::string>& buffer) const
+		{
+			const char* text;
+			std::size_t size;
+			if (!match(buffer, text, size))
+				return maybe<std::string>::nothing;
+
+			return maybe<std::string>::just(std::string(text, size));
+		}
+
+		bool do_recognize(buffer<std::string>& buffer) const
+		{
+			const char* text;
+			std::size_t size;
+			return match(buffer, text, size);
+		}
+
+	private:
+		//! Alternatives before the one that matched may have looked further, up to the longest.
+		static bool match(buffer<std::string>& buffer, const char*& text, std::size_t& size)
+		{
+			auto& data = buffer.data();
+			buffer.examine(buffer.offset() + alternatives::longest());
+			if (!alternatives::match(data.data() + buffer.offset(), data.size() - buffer.offset(), text, size))
+				return false;
+
+			buffer.advance(size);
+			return true;
+		}
+	};
+
+	//! Character "i" of the literal "s", or '\0' past its end. Used by "CPPARSE_LIT".
+	template<std::size_t N>
+	constexpr char literal_at(const char (&s)[N], std::size_t i)
+	{
+		return i < N - 1 ? s[i] : '\0';
+	}
+
+	//! Collect characters into a literal_parser, stopping at the first '\0'.
+	template<typename L, char... Cs>
+	struct literal_trim;
+
+	template<char... Kept>
+	struct literal_trim<literal_parser<Kept...>>
+	{
+		typedef literal_parser<Kept...> type;
+	};
+
+	template<char... Kept, char... Rest>
+	struct literal_trim<literal_parser<Kept...>, '\0', Rest...>
+	{
+		typedef literal_parser<Kept...> type;
+	};
+
+	template<char... Kept, char C, char... Rest>
+	struct literal_trim<literal_parser<Kept...>, C, Rest...>
+	{
+		typedef typename literal_trim<literal_parser<Kept..., C>, Rest...>::type type;
+	};
+
+	// ******************************************************************
+	//! Classes - sets of characters fixed at compile time.
+	// ******************************************************************
+
+	//! True if "c" is in one of the inclusive ranges given as pairs of bounds.
+	template<char... Bounds>
+	struct class_ranges;
+
+	template<>
+	struct class_ranges<>
+	{
+		static constexpr bool contains(unsigned char) { return false; }
+	};
+
+	template<char First, char Last, char... Rest>
+	struct class_ranges<First, Last, Rest...>
+	{
+		static constexpr bool contains(unsigned char c)
+		{
+			return (c >= static_cast<unsigned char>(First) && c <= static_cast<unsigned char>(Last)) || class_ranges<Rest...>::contains(c);
+		}
+	};
+
+	//! The bits for characters [64 * word, 64 * word + 64) of a class, built at compile time.
+	template<class R>
+	constexpr std::uint64_t class_word(unsigned word, unsigned bit = 0)
+	{
+		return bit == 64 ? 0 : ((R::contains(static_cast<unsigned char>(word * 64 + bit)) ? (std::uint64_t(1) << bit) : 0) | class_word<R>(word, bit + 1));
+	}
+
+	//! Parse one character in the ranges "Bounds", e.g. <'a', 'z', '0', '9'>.
+	/*! Membership is one test against a 256-bit table built at compile time. */
+	template<char... Bounds>
+	class class_parser : public parser<char, std::string>
+	{
+		static_assert(sizeof...(Bounds) > 0 && sizeof...(Bounds) % 2 == 0, "cpparse::cls : Ranges are given as pairs of first and last characters!");
+
+	private:
+		typedef class_ranges<Bounds...> ranges;
+
+	public:
+		static constexpr std::uint64_t table[4] = { class_word<ranges>(0), class_word<ranges>(1), class_word<ranges>(2), class_word<ranges>(3) };
+
+		static bool contains(char c)
+		{
+			auto u = static_cast<unsigned char>(c);
+			return (table[u >> 6] >> (u & 63)) & 1;
+		}
+
+	public:
+		class_parser()
+		: parser<char, std::string>() {}
+
+		class_parser(const class_parser&) = default;
+		~class_parser() = default;
+
+		const char* kind() const { return "class"; }
+		std::string expected() const
+		{
+			static const char bounds[] = { Bounds... };
+
+			std::string ranges;
+			for (std::size_t i = 0; i < sizeof(bounds); i += 2)
+				ranges += (bounds[i] == bounds[i + 1]) ? std::string(1, bounds[i]) : std::string{ bounds[i], '-', bounds[i + 1] };
+
+			return "one of [" + ranges + "]";
+		}
+
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<char> apply(buffer<std::string>& buffer) const
+		{
+			auto& data = buffer.data();
+			auto offset = buffer.offset();
+			if (offset == data.size() || !contains(data[offset]))
+			{
+				buffer.examine(offset + 1);
+				return maybe<char>::nothing;
+			}
+
+			buffer.advance(1);
+			return maybe<char>::just(data[offset]);
+		}
+	};
+
+	template<char... Bounds>
+	constexpr std::uint64_t class_parser<Bounds...>::table[4];
+}
+}
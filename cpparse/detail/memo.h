@@ -0,0 +1,233 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include "parser.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	//! The results of "memo" parsers, kept from one parse of a document to the next.
+	/*! Each entry is a successful match by one parser at one offset: how much
+	 *  it consumed, how much of the input it looked at (its "extent", which
+	 *  includes input read by alternatives that failed, and lookahead) and
+	 *  its result. A match depends only on the input in its extent, so after
+	 *  an edit only the entries whose extent overlaps the edited input are
+	 *  dropped.
+	 *
+	 *  Entries are kept like a gap buffer: those before the last edit by
+	 *  their offset from the start, and those after it by their offset from
+	 *  the end, which an edit does not change. Moving the gap to the next
+	 *  edit only moves the entries in between, so the cost of an edit grows
+	 *  with its distance from the last one, not with the size of the input.
+	 */
+	class memo_table
+	{
+	public:
+		struct entry
+		{
+			std::size_t length;
+			std::size_t extent;
+			std::shared_ptr<const void> result;
+		};
+
+	public:
+		memo_table()
+		: m_size(0), m_gap(0), m_longest(0), m_hits(0) {}
+
+		memo_table(const memo_table&) = delete;
+		~memo_table() = default;
+
+		//! Start over with an input of "size" values, e.g. when the whole text is replaced.
+		void reset(std::size_t size)
+		{
+			m_front.clear();
+			m_back.clear();
+			m_size = size;
+			m_gap = 0;
+			m_longest = 0;
+			m_hits = 0;
+		}
+
+		//! The match of "node" at "start", or nullptr.
+		const entry* find(const parser_node* node, std::size_t start)
+		{
+			auto& side = (start < m_gap) ? m_front : m_back;
+			auto found = side.find(key(node, start));
+			if (found == side.end())
+				return nullptr;
+
+			m_hits += 1;
+			return &found->second;
+		}
+
+		void store(const parser_node* node, std::size_t start, const entry& e)
+		{
+			auto& side = (start < m_gap) ? m_front : m_back;
+			side[key(node, start)] = e;
+			m_longest = std::max(m_longest, e.extent);
+		}
+
+		//! The values in [offset, offset + removed) were replaced with "inserted" values.
+		void edit(std::size_t offset, std::size_t removed, std::size_t inserted)
+		{
+			if (offset > m_size || removed > m_size - offset)
+				throw std::out_of_range("cpparse::memo_table : An edit is outside of the input!");
+
+			move_gap(offset);
+
+			//! Entries starting before the edit, which looked at some of it.
+			/*! None can start further back than the longest extent. */
+			auto i = m_front.end();
+			while (i != m_front.begin())
+			{
+				--i;
+				if (i->first.first + m_longest <= offset)
+					break;
+
+				if (i->first.first + i->second.extent > offset)
+					i = m_front.erase(i);
+			}
+
+			//! Entries starting in the removed input. The rest only move.
+			if (removed)
+				m_back.erase(m_back.lower_bound(std::make_pair(m_size - offset - removed + 1, nullptr)), m_back.end());
+
+			m_size = m_size - removed + inserted;
+		}
+
+		//! How many entries are kept, and how many were used since the last "reset_hits".
+		std::size_t size() const { return m_front.size() + m_back.size(); }
+		std::size_t hits() const { return m_hits; }
+		void reset_hits() { m_hits = 0; }
+
+	private:
+		typedef std::pair<std::size_t, const parser_node*> key_type;
+
+		key_type key(const parser_node* node, std::size_t start) const
+		{
+			return (start < m_gap) ? std::make_pair(start, node) : std::make_pair(m_size - start, node);
+		}
+
+		//! Move the entries between the gap and "offset" to the other side.
+		void move_gap(std::size_t offset)
+		{
+			if (offset < m_gap)
+			{
+				auto from = m_front.lower_bound(std::make_pair(offset, nullptr));
+				for (auto i = from; i != m_front.end(); ++i)
+					m_back.insert(std::make_pair(std::make_pair(m_size - i->first.first, i->first.second), i->second));
+
+				m_front.erase(from, m_front.end());
+			}
+			else if (offset > m_gap)
+			{
+				auto from = m_back.lower_bound(std::make_pair(m_size - offset + 1, nullptr));
+				for (auto i = from; i != m_back.end(); ++i)
+					m_front.insert(std::make_pair(std::make_pair(m_size - i->first.first, i->first.second), i->second));
+
+				m_back.erase(from, m_back.end());
+			}
+
+			m_gap = offset;
+		}
+
+	private:
+		std::map<key_type, entry> m_front, m_back;
+		std::size_t m_size, m_gap;
+		std::size_t m_longest;
+		std::size_t m_hits;
+	};
+
+	//! A parser whose matches are kept in the context's memo table, and reused.
+	/*! Without a memo table it only passes the parse through. Failures are
+	 *  not kept, so an alternative that fails is tried again on each parse.
+	 */
+	template<typename R, typename T>
+	class memo_parser : public parser<R, T>
+	{
+	private:
+		typedef typename parser_traits<parser<R, T>>::type_pointer subtype_pointer;
+
+	public:
+		memo_parser(subtype_pointer p)
+		: parser<R, T>(), m_parser(p) {}
+
+		memo_parser(const memo_parser&) = default;
+		~memo_parser() = default;
+
+		const char* kind() const { return "memo"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_parser.get()); }
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<R> apply(buffer<T>& buffer) const
+		{
+			auto table = memo(buffer);
+			if (!table)
+				return m_parser->parse(buffer);
+
+			auto start = buffer.offset();
+			if (auto found = table->find(this, start))
+			{
+				reuse(buffer, start, *found);
+				return maybe<R>::just(*static_cast<const R*>(found->result.get()));
+			}
+
+			auto outer = buffer.examined();
+			buffer.set_examined(start);
+
+			auto result = m_parser->parse(buffer);
+			auto extent = std::max(buffer.examined(), buffer.offset()) - start;
+			if (result.is_just())
+			{
+				memo_table::entry e = { buffer.offset() - start, extent, std::make_shared<R>(*result) };
+				table->store(this, start, e);
+			}
+
+			buffer.set_examined(std::max(outer, start + extent));
+			return result;
+		}
+
+		//! Matches are reused, but a recognize has no result to keep, so new ones are not.
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			auto table = memo(buffer);
+			if (table)
+			{
+				auto start = buffer.offset();
+				if (auto found = table->find(this, start))
+				{
+					reuse(buffer, start, *found);
+					return true;
+				}
+			}
+
+			return m_parser->recognize(buffer);
+		}
+
+	private:
+		static memo_table* memo(const buffer<T>& buffer)
+		{
+			auto context = buffer.context();
+			return context ? context->memo() : nullptr;
+		}
+
+		//! Skip the match, and pass on how far it looked, for the memo parsers around this one.
+		static void reuse(buffer<T>& buffer, std::size_t start, const memo_table::entry& e)
+		{
+			buffer.advance(e.length);
+			buffer.set_examined(std::max(buffer.examined(), start + e.extent));
+		}
+
+	private:
+		subtype_pointer m_parser;
+	};
+}
+}
@@ -0,0 +1,406 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <clocale>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#include "parser.h"
+#include "../maybe.h"
+#include "../buffer.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	// ******************************************************************
+	//! Digit scanning - eight digits at a time, as one 64-bit word.
+	// ******************************************************************
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CPPARSE_SWAR_DIGITS 1
+#else
+#define CPPARSE_SWAR_DIGITS 0
+#endif
+
+	inline std::uint64_t load_eight(const char* p)
+	{
+		std::uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	//! True if all eight bytes are '0' to '9'.
+	inline bool eight_digits(std::uint64_t v)
+	{
+		return (((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL);
+	}
+
+	//! The value of eight digits, the first in the lowest byte.
+	/*! Pairs, then quads, then the whole word are combined with three multiplies. */
+	inline std::uint32_t eight_digit_value(std::uint64_t v)
+	{
+		v -= 0x3030303030303030ULL;
+		v = (v * 10) + (v >> 8);
+		v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+			+ (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+
+		return static_cast<std::uint32_t>(v);
+	}
+
+	inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+	//! How far past the point where a number stops its syntax may look: a hex prefix's "x" and digit, or an exponent's sign and digit.
+	const std::size_t number_lookahead = 3;
+
+	//! The number of decimal digits starting at "p".
+	inline std::size_t count_digits(const char* p, const char* end)
+	{
+		auto start = p;
+#if CPPARSE_SWAR_DIGITS
+		while (end - p >= 8 && eight_digits(load_eight(p)))
+			p += 8;
+#endif
+		while (p != end && is_digit(*p))
+			++p;
+
+		return p - start;
+	}
+
+	//! The value of at most 19 decimal digits, which always fits.
+	inline std::uint64_t digits_value(const char* p, std::size_t n)
+	{
+		std::uint64_t value = 0;
+#if CPPARSE_SWAR_DIGITS
+		for (; n >= 8; n -= 8, p += 8)
+			value = value * 100000000ULL + eight_digit_value(load_eight(p));
+#endif
+		for (; n; --n, ++p)
+			value = value * 10 + (*p - '0');
+
+		return value;
+	}
+
+	inline int hex_value(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+
+		return -1;
+	}
+
+	// ******************************************************************
+	//! Integers
+	// ******************************************************************
+
+	//! Parse an integer of type T straight from the characters of the buffer.
+	/*! Decimal digits, or hexadecimal digits after an optional "0x", with an
+	 *  optional sign if "sign" is set. A value that does not fit in T fails,
+	 *  as does a sign or "0x" without digits; nothing is consumed then.
+	 */
+	template<typename T>
+	class integer_parser : public parser<T, std::string>
+	{
+		static_assert(std::is_integral<T>::value && sizeof(T) <= sizeof(std::uint64_t), "cpparse::integer : T must be an integer of at most 64 bits!");
+
+	public:
+		integer_parser(bool sign, bool hex)
+		: parser<T, std::string>(), m_sign(sign), m_hex(hex) {}
+
+		integer_parser(const integer_parser&) = default;
+		~integer_parser() = default;
+
+		const char* kind() const { return "integer"; }
+		std::string expected() const { return m_hex ? "hexadecimal number" : (m_sign ? "integer" : "unsigned integer"); }
+
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<T> apply(buffer<std::string>& buffer) const
+		{
+			auto& data = buffer.data();
+			const char* start = data.data() + buffer.offset();
+			const char* end = data.data() + data.size();
+			const char* p = start;
+
+			bool negative = false;
+			if (m_sign && p != end && (*p == '-' || *p == '+'))
+				negative = (*p++ == '-');
+
+			//! The largest magnitude allowed, one more than the max for negative signed values.
+			std::uint64_t limit = static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+			if (negative)
+			{
+				if (!std::is_signed<T>::value)
+					limit = 0;
+				else
+					limit += 1;
+			}
+
+			std::uint64_t magnitude;
+			bool scanned = m_hex ? hexadecimal(p, end, magnitude) : decimal(p, end, magnitude);
+			buffer.examine(buffer.offset() + (p - start) + number_lookahead);
+			if (!scanned || magnitude > limit)
+				return maybe<T>::nothing;
+
+			buffer.advance(p - start);
+
+			//! Negate in unsigned arithmetic, so the minimum value does not overflow.
+			T value = negative ? static_cast<T>(0 - magnitude) : static_cast<T>(magnitude);
+			return maybe<T>::just(value);
+		}
+
+	private:
+		//! Read decimal digits, failing if there are none or they do not fit in 64 bits.
+		static bool decimal(const char*& p, const char* end, std::uint64_t& value)
+		{
+			auto n = count_digits(p, end);
+			if (!n)
+				return false;
+
+			auto digits = p;
+			p += n;
+
+			//! Leading zeros do not count toward overflow.
+			while (n > 1 && *digits == '0')
+			{
+				++digits;
+				--n;
+			}
+
+			if (n <= 19)
+			{
+				value = digits_value(digits, n);
+				return true;
+			}
+
+			if (n > 20)
+				return false;
+
+			value = digits_value(digits, 19);
+			auto last = static_cast<std::uint64_t>(digits[19] - '0');
+			if (value > (std::numeric_limits<std::uint64_t>::max() - last) / 10)
+				return false;
+
+			value = value * 10 + last;
+			return true;
+		}
+
+		static bool hexadecimal(const char*& p, const char* end, std::uint64_t& value)
+		{
+			auto q = p;
+			if (end - q >= 3 && q[0] == '0' && (q[1] == 'x' || q[1] == 'X') && hex_value(q[2]) >= 0)
+				q += 2;
+
+			if (q == end || hex_value(*q) < 0)
+				return false;
+
+			value = 0;
+			for (int d; q != end && (d = hex_value(*q)) >= 0; ++q)
+			{
+				if (value >> 60)
+					return false;
+
+				value = (value << 4) | static_cast<std::uint64_t>(d);
+			}
+
+			p = q;
+			return true;
+		}
+
+	private:
+		bool m_sign, m_hex;
+	};
+
+	// ******************************************************************
+	//! Floating point
+	// ******************************************************************
+
+	template<typename T>
+	struct float_traits;
+
+	template<>
+	struct float_traits<float>
+	{
+		//! Integers up to 2^24 and powers of ten up to 10^10 are exact, so their product or quotient is correctly rounded.
+		static const std::uint64_t max_exact = 1ULL << 24;
+		static const int max_exact_power = 10;
+
+		static float convert(const char* s, char** end) { return std::strtof(s, end); }
+	};
+
+	template<>
+	struct float_traits<double>
+	{
+		static const std::uint64_t max_exact = 1ULL << 53;
+		static const int max_exact_power = 22;
+
+		static double convert(const char* s, char** end) { return std::strtod(s, end); }
+	};
+
+	template<>
+	struct float_traits<long double>
+	{
+		//! No fast path; every value goes through "strtold".
+		static const std::uint64_t max_exact = 0;
+		static const int max_exact_power = -1;
+
+		static long double convert(const char* s, char** end) { return std::strtold(s, end); }
+	};
+
+	//! Parse a floating point number straight from the characters of the buffer.
+	/*! The syntax is "[+-]digits[.digits][(e|E)[+-]digits]", where either
+	 *  side of the point may be empty but not both. An exponent without
+	 *  digits is left unconsumed. Values too large for T fail.
+	 *
+	 *  Numbers with few enough digits and a small exponent are computed
+	 *  exactly with one multiply or divide. Others are converted by the C
+	 *  library, which rounds correctly, from a copy on the stack.
+	 */
+	template<typename T>
+	class floating_parser : public parser<T, std::string>
+	{
+		static_assert(std::is_floating_point<T>::value, "cpparse::floating : T must be a floating point type!");
+
+	public:
+		floating_parser()
+		: parser<T, std::string>() {}
+
+		floating_parser(const floating_parser&) = default;
+		~floating_parser() = default;
+
+		const char* kind() const { return "floating"; }
+		std::string expected() const { return "number"; }
+
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<T> apply(buffer<std::string>& buffer) const
+		{
+			auto& data = buffer.data();
+			const char* start = data.data() + buffer.offset();
+			const char* end = data.data() + data.size();
+			const char* p = start;
+
+			bool negative = false;
+			if (p != end && (*p == '-' || *p == '+'))
+				negative = (*p++ == '-');
+
+			auto integral = p;
+			auto integral_digits = count_digits(p, end);
+			p += integral_digits;
+
+			const char* fraction = p;
+			std::size_t fraction_digits = 0;
+			if (p != end && *p == '.')
+			{
+				fraction = ++p;
+				fraction_digits = count_digits(p, end);
+				p += fraction_digits;
+			}
+
+			if (!integral_digits && !fraction_digits)
+			{
+				buffer.examine(buffer.offset() + (p - start) + number_lookahead);
+				return maybe<T>::nothing;
+			}
+
+			int exponent = 0;
+			bool exponent_fits = true;
+			if (p != end && (*p == 'e' || *p == 'E'))
+			{
+				auto q = p + 1;
+				bool exponent_negative = false;
+				if (q != end && (*q == '-' || *q == '+'))
+					exponent_negative = (*q++ == '-');
+
+				auto exponent_digits = count_digits(q, end);
+				if (exponent_digits)
+				{
+					exponent_fits = (exponent_digits <= 4);
+					if (exponent_fits)
+						exponent = static_cast<int>(digits_value(q, exponent_digits)) * (exponent_negative ? -1 : 1);
+
+					p = q + exponent_digits;
+				}
+			}
+
+			buffer.examine(buffer.offset() + (p - start) + number_lookahead);
+
+			T value;
+			if (!exponent_fits || !fast_path(integral, integral_digits, fraction, fraction_digits, exponent, value))
+				value = slow_path(start, p);
+			else if (negative)
+				value = -value;
+
+			if (std::isinf(value))
+				return maybe<T>::nothing;
+
+			buffer.advance(p - start);
+			return maybe<T>::just(value);
+		}
+
+	private:
+		typedef float_traits<T> traits;
+
+		//! Exact when the digits, without the point, form an exactly representable integer, scaled by an exact power of ten.
+		static bool fast_path(const char* integral, std::size_t integral_digits, const char* fraction, std::size_t fraction_digits, int exponent, T& value)
+		{
+			if (integral_digits + fraction_digits > 19)
+				return false;
+
+			std::uint64_t mantissa = digits_value(integral, integral_digits);
+			for (std::size_t i = 0; i < fraction_digits; ++i)
+				mantissa = mantissa * 10 + (fraction[i] - '0');
+
+			exponent -= static_cast<int>(fraction_digits);
+			if (mantissa > traits::max_exact || exponent < -traits::max_exact_power || exponent > traits::max_exact_power)
+				return false;
+
+			static const T powers[] = {
+				T(1e0), T(1e1), T(1e2), T(1e3), T(1e4), T(1e5), T(1e6), T(1e7), T(1e8), T(1e9), T(1e10),
+				T(1e11), T(1e12), T(1e13), T(1e14), T(1e15), T(1e16), T(1e17), T(1e18), T(1e19), T(1e20), T(1e21), T(1e22)
+			};
+
+			value = static_cast<T>(mantissa);
+			value = (exponent < 0) ? value / powers[-exponent] : value * powers[exponent];
+			return true;
+		}
+
+		//! Convert with the C library, using the locale's decimal point, which is not always '.'.
+		static T slow_path(const char* start, const char* end)
+		{
+			std::size_t n = end - start;
+			char local[128];
+			std::vector<char> large;
+			char* copy = local;
+			if (n >= sizeof(local))
+			{
+				large.resize(n + 1);
+				copy = large.data();
+			}
+
+			std::memcpy(copy, start, n);
+			copy[n] = '\0';
+
+			char point = *std::localeconv()->decimal_point;
+			if (point != '.')
+			{
+				if (auto dot = static_cast<char*>(std::memchr(copy, '.', n)))
+					*dot = point;
+			}
+
+			return traits::convert(copy, nullptr);
+		}
+	};
+}
+}
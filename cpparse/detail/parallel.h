@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <exception>
+#include <algorithm>
+
+namespace cpparse
+{
+namespace detail
+{
+	//! One worker's share of the work in a "parallel_for" call.
+	/*! Padded to a cache line, so a worker taking items from its own range
+	 *  never contends with the other workers.
+	 */
+	struct work_range
+	{
+		std::atomic<std::size_t> next;
+		std::size_t end;
+		char padding[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+	};
+
+	//! Call a function once for every index in [0, count), using several threads.
+	/*! The indices are split evenly between the workers. A worker that runs
+	 *  out of its own indices steals from the others, so uneven work still
+	 *  keeps every thread busy. Claiming an index is a single atomic add on
+	 *  the range it comes from; no locks are taken.
+	 *
+	 *  The first exception thrown by "f" is rethrown once all workers stop.
+	 */
+	template<typename F>
+	void parallel_for(std::size_t count, std::size_t threads, const F& f)
+	{
+		if (!threads)
+			threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+		threads = std::max<std::size_t>(1, std::min(threads, count));
+
+		if (threads == 1)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				f(i);
+			return;
+		}
+
+		std::unique_ptr<work_range[]> ranges(new work_range[threads]);
+		for (std::size_t w = 0; w < threads; ++w)
+		{
+			ranges[w].next = count * w / threads;
+			ranges[w].end = count * (w + 1) / threads;
+		}
+
+		std::atomic<bool> failed(false);
+		std::exception_ptr error;
+
+		auto work = [&](std::size_t self)
+		{
+			try
+			{
+				//! Start with our own range, then visit the others in turn.
+				for (std::size_t k = 0; k < threads && !failed; ++k)
+				{
+					work_range& range = ranges[(self + k) % threads];
+					while (!failed)
+					{
+						auto i = range.next.fetch_add(1, std::memory_order_relaxed);
+						if (i >= range.end)
+							break;
+
+						f(i);
+					}
+				}
+			}
+			catch (...)
+			{
+				if (!failed.exchange(true))
+					error = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (std::size_t w = 1; w < threads; ++w)
+			workers.emplace_back(work, w);
+
+		work(0);
+		for (auto& t : workers)
+			t.join();
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
+}
@@ -3,22 +3,181 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <unordered_set>
 #include <algorithm>
+#include <stdexcept>
 
 #include "../maybe.h"
 #include "../buffer.h"
+#include "../context.h"
 #include "parser_traits.h"
 
 namespace cpparse
 {
 namespace detail
 {
+	//! What a parser is written to by its "regular", "generate" and "save" hooks.
+	/*! Only declared here. The hooks of the library's parsers are defined
+	 *  with them, in "regular_parsers.h", "generate_parsers.h" and
+	 *  "save_parsers.h", which "regular.h", "codegen.h" and "image.h"
+	 *  include. As the hooks are virtual, a translation unit that makes
+	 *  parsers must include those as well, as "cpparse.h" does.
+	 */
+	class regular_expression;
+	class generator;
+	class image_writer;
+
+	//! Quote text for an error message, escaping anything unprintable.
+	inline std::string quote(const std::string& s, char mark = '\"')
+	{
+		std::string quoted(1, mark);
+		for (unsigned char c : s)
+		{
+			if (c == '\n')
+				quoted += "\\n";
+			else if (c == '\t')
+				quoted += "\\t";
+			else if (c == '\r')
+				quoted += "\\r";
+			else if (c == mark || c == '\\')
+				quoted += std::string(1, '\\') + char(c);
+			else if (c < 0x20 || c == 0x7f)
+			{
+				const char* hex = "0123456789abcdef";
+				quoted += std::string("\\x") + hex[c >> 4] + hex[c & 15];
+			}
+			else
+				quoted += char(c);
+		}
+
+		return quoted + mark;
+	}
+
+	//! List a set of tokens for an error message. Only characters can be listed.
+	template<typename R>
+	std::string describe_tokens(const std::vector<R>&) { return std::string(); }
+
+	inline std::string describe_tokens(const std::vector<char>& c) { return " " + quote(std::string(c.begin(), c.end())); }
+
+	//! A function with a name, so that code generated from a grammar can call it. See "callback".
+	template<typename F>
+	struct named_callback
+	{
+		std::string name;
+		F function;
+	};
+
+	//! The untyped base of every parser.
+	/*! Holds everything that does not depend on the result type, so a grammar
+	 *  can be walked (e.g. to freeze it) without knowing the type of each node.
+	 */
+	class parser_node
+	{
+	public:
+		parser_node()
+		: m_tag(), m_frozen(false) {}
+
+		//! A copy is a new node, so it never inherits the frozen state.
+		parser_node(const parser_node& other)
+		: m_tag(other.m_tag), m_frozen(false) {}
+
+		virtual ~parser_node() = default;
+
+		const std::string& tag() const { return m_tag; }
+		std::string tag() { return m_tag; }
+
+		void set_tag(const std::string& t)
+		{
+			check_mutable();
+			m_tag = t;
+		}
+
+		//! A short name for the type of parser, e.g. "choice".
+		virtual const char* kind() const { return "parser"; }
+
+		//! What the parser looks for, in an error message, e.g. "\"let\"".
+		/*! Parsers that only combine others return an empty string, since
+		 *  the parsers they contain describe the input better.
+		 */
+		virtual std::string expected() const { return std::string(); }
+
+		//! Append every parser this one passes input to.
+		virtual void children(std::vector<parser_node*>&) const {}
+
+		//! Add the language this parser matches to "r", if it is regular. See "compile_regular".
+		/*! Returns the index of the expression added, or -1 for parsers that
+		 *  are not regular or that build their results with functions, e.g.
+		 *  lifts, blocks and placeholders.
+		 */
+		virtual int regular(regular_expression&) const { return -1; }
+
+		//! Write this parser as C++ functions with "g.define". See "code_generator".
+		/*! Returns false for parsers that cannot be generated. */
+		virtual bool generate(generator&) const { return false; }
+
+		//! Add this parser to a grammar image with "w.emit". See "save_image".
+		/*! Returns false for parsers that cannot be saved. */
+		virtual bool save(image_writer&) const { return false; }
+
+		//! False if the parser cannot be used yet, e.g. an unset placeholder.
+		virtual bool complete() const { return true; }
+
+		bool frozen() const { return m_frozen; }
+
+		//! Mark this parser and everything reachable from it as immutable.
+		/*! The whole grammar is checked before any of it is frozen, so an
+		 *  incomplete grammar is left as it was and can be frozen once it is
+		 *  finished. A frozen node's parsers are all frozen already, so they
+		 *  are not visited again; cycles are handled with a visited set.
+		 */
+		void freeze()
+		{
+			std::vector<parser_node*> found;
+			std::unordered_set<parser_node*> visited;
+
+			std::vector<parser_node*> pending(1, this);
+			while (!pending.empty())
+			{
+				auto node = pending.back();
+				pending.pop_back();
+
+				if (node->m_frozen || !visited.insert(node).second)
+					continue;
+
+				if (!node->complete())
+					throw std::logic_error("cpparse::parser : Cannot freeze an incomplete grammar!");
+
+				found.push_back(node);
+				node->children(pending);
+			}
+
+			for (auto node : found)
+				node->m_frozen = true;
+		}
+
+	protected:
+		//! Every function that changes a parser after creation should call this.
+		void check_mutable() const
+		{
+			if (m_frozen)
+				throw std::logic_error("cpparse::parser : Cannot modify a frozen grammar!");
+		}
+
+	private:
+		std::string m_tag;
+		bool m_frozen;
+	};
+
 	//! The generic parser interface.
 	/*! Takes an input type and an output type. Note that the actual type
 	 *  to be parsed is "buffer<T>::value_type".
+	 *
+	 *  Parsing never modifies a parser, so once a grammar is frozen the same
+	 *  parser can be used from any number of threads at once, as long as each
+	 *  thread parses its own buffer.
 	 */
 	template<typename R, typename T>
-	class parser
+	class parser : public parser_node
 	{
 	public:
 		typedef T value_type;
@@ -29,19 +188,63 @@ namespace detail
 		parser(const parser& other) = default;
 		virtual ~parser() = default;
 
-		const std::string& tag() const { return m_tag; }
-		std::string tag() { return m_tag; }
+		//! Apply the parser to the input.
+		/*! Every parse passes through here, so this is where the buffer's
+		 *  context (if any) is told about each step.
+		 */
+		maybe<result_type> parse(buffer<value_type>& buffer) const
+		{
+			return invoke<maybe<result_type>>(buffer, [this](cpparse::buffer<value_type>& b) { return apply(b); });
+		}
 
-		void set_tag(const std::string& t) { m_tag = t; }
+		//! Match the input like "parse", but without building a result.
+		/*! Returns whether the parser matched, and moves the buffer the same
+		 *  way "parse" would. Functions given to lifts and blocks are not
+		 *  called.
+		 */
+		bool recognize(buffer<value_type>& buffer) const
+		{
+			return invoke<bool>(buffer, [this](cpparse::buffer<value_type>& b) { return do_recognize(b); });
+		}
 
 		//! All parser types should overload this function.
 		/*! A parser is also expected to, upon failure, return the buffer to
-		 *  its state at the start of the call.
+		 *  its state at the start of the call. Parsers should call "parse",
+		 *  not "apply", on the parsers they contain.
 		 */
-		virtual maybe<result_type> parse(buffer<value_type>&) const = 0;
+		virtual maybe<result_type> apply(buffer<value_type>&) const = 0;
+
+		//! Parser types whose result costs something to build should overload this as well.
+		/*! The default parses, and throws the result away. Overloads should
+		 *  call "recognize" on the parsers they contain.
+		 */
+		virtual bool do_recognize(buffer<value_type>& buffer) const { return apply(buffer).is_just(); }
 
 	private:
-		std::string m_tag;
+		static bool matched(const maybe<result_type>& result) { return result.is_just(); }
+		static bool matched(bool result) { return result; }
+
+		//! Tell the buffer's context and the probes about a call to "parse" or "recognize".
+		template<typename Result, typename F>
+		Result invoke(buffer<value_type>& buffer, const F& f) const
+		{
+			auto context = buffer.context();
+			if (context)
+				context->step();
+
+#if CPPARSE_PROBES
+			probe_scope scope(*this, buffer.offset());
+
+			Result result = f(buffer);
+			scope.leave(buffer.offset(), matched(result));
+#else
+			Result result = f(buffer);
+#endif
+			if (context && !matched(result))
+				context->failed(*this, buffer.offset());
+
+			return result;
+		}
 	};
 
 	//! A basic parser 'wrapper'.
@@ -64,14 +267,53 @@ namespace detail
 		~forward_parser() = default;
 
 		//! Set the parser to pass operations to. Can also be reset to nullptr.
-		void set_target(subtype_pointer p) { m_target = p; }
+		void set_target(subtype_pointer p)
+		{
+			this->check_mutable();
+			m_target = p;
+		}
 
-		maybe<R> parse(buffer<T>& buffer) const
+		const char* kind() const { return "forward"; }
+		void children(std::vector<parser_node*>& c) const { if (m_target) c.push_back(m_target.get()); }
+		bool complete() const { return (m_target != nullptr); }
+
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		//! Recursion always passes through a forward parser, so this is where depth is tracked.
+		/*! It is also where the parse moves to a new stack segment, when the
+		 *  context has one to give (see "parse_deep").
+		 */
+		maybe<R> apply(buffer<T>& buffer) const
 		{
+			auto context = buffer.context();
+			if (context && context->stack_switcher() && context->stack_exhausted())
+			{
+				maybe<R> result;
+				context->stack_switcher()->run([&]() { result = apply(buffer); });
+				return result;
+			}
+
+			depth_guard guard(context);
+
 			maybe<R> result = m_target->parse(buffer);
 			return result;
 		}
 
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			auto context = buffer.context();
+			if (context && context->stack_switcher() && context->stack_exhausted())
+			{
+				bool result = false;
+				context->stack_switcher()->run([&]() { result = do_recognize(buffer); });
+				return result;
+			}
+
+			depth_guard guard(context);
+			return m_target->recognize(buffer);
+		}
+
 	private:
 		subtype_pointer m_target;
 	};
@@ -94,7 +336,13 @@ namespace detail
 		skip_parser(const skip_parser&) = default;
 		~skip_parser() = default;
 
-		maybe<M> parse(buffer<T>& buffer) const
+		const char* kind() const { return "skip"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_parser.get()); }
+
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<M> apply(buffer<T>& buffer) const
 		{
 			auto ignore = m_parser->parse(buffer);
 			if (ignore.is_just())
@@ -103,10 +351,74 @@ namespace detail
 			return maybe<M>::nothing;
 		}
 
+		bool do_recognize(buffer<T>& buffer) const { return m_parser->recognize(buffer); }
+
 	private:
 		subtype_pointer m_parser;
 	};
 
+	//! The empty value a lookahead returns: that of the inner parser, except
+	//! that characters give a string, so lookahead can be merged into string parsers.
+	template<typename R>
+	struct lookahead_result { typedef R type; };
+
+	template<>
+	struct lookahead_result<char> { typedef std::string type; };
+
+	//! Check what comes next without consuming it.
+	/*! Succeeds if the inner parser matches (or, when "negative", if it does
+	 *  not), and always leaves the buffer where it was. The inner parser is
+	 *  only recognized, never parsed, so no result is built, and like
+	 *  skip_parser an empty value is returned.
+	 */
+	template<typename T, typename M, typename P>
+	class lookahead_parser : public parser<M, T>
+	{
+	private:
+		typedef typename parser_traits<parser<P, T>>::type_pointer subtype_pointer;
+
+	public:
+		lookahead_parser(subtype_pointer p, bool negative)
+		: parser<M, T>(), m_parser(p), m_negative(negative) {}
+
+		lookahead_parser(const lookahead_parser&) = default;
+		~lookahead_parser() = default;
+
+		const char* kind() const { return m_negative ? "not_followed_by" : "followed_by"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_parser.get()); }
+
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<M> apply(buffer<T>& buffer) const
+		{
+			if (do_recognize(buffer))
+				return maybe<M>::just(M());
+
+			return maybe<M>::nothing;
+		}
+
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			auto start = buffer.here();
+
+			bool matched;
+			{
+				mute_guard guard(m_negative ? buffer.context() : nullptr);
+				matched = m_parser->recognize(buffer);
+			}
+
+			if (matched)
+				buffer.rewind(start);
+
+			return (matched != m_negative);
+		}
+
+	private:
+		subtype_pointer m_parser;
+		bool m_negative;
+	};
+
 	//! A parser that, on failure, returns an alternate value.
 	/*! The option parser always returns maybe<R>::just. */
 	template<typename R, typename T>
@@ -122,7 +434,13 @@ namespace detail
 		option_parser(const option_parser&) = default;
 		~option_parser() = default;
 
-		maybe<R> parse(buffer<T>& buffer) const
+		const char* kind() const { return "option"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_parser.get()); }
+
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<R> apply(buffer<T>& buffer) const
 		{
 			auto possible = m_parser->parse(buffer);
 
@@ -130,11 +448,70 @@ namespace detail
 			return maybe<R>::just(result);
 		}
 
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			m_parser->recognize(buffer);
+			return true;
+		}
+
 	private:
 		subtype_pointer m_parser;
 		R m_alternate;
 	};
 
+	//! A parser that must succeed once it is reached.
+	/*! If the inner parser fails, "commit_failed" is thrown instead of
+	 *  returning nothing, so the choices and blocks around it do not rewind
+	 *  and try their other alternatives. While it runs, the buffer's cut
+	 *  offset is at least where it started; it is put back afterwards,
+	 *  whether the parser succeeds or throws.
+	 */
+	template<typename R, typename T>
+	class commit_parser : public parser<R, T>
+	{
+	private:
+		typedef typename parser_traits<parser<R, T>>::type_pointer subtype_pointer;
+
+	public:
+		commit_parser(subtype_pointer p)
+		: parser<R, T>(), m_parser(p) {}
+
+		commit_parser(const commit_parser&) = default;
+		~commit_parser() = default;
+
+		const char* kind() const { return "commit"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_parser.get()); }
+
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<R> apply(buffer<T>& buffer) const
+		{
+			auto start = buffer.offset();
+			cut_guard<cpparse::buffer<T>> cut(buffer, start);
+
+			auto result = m_parser->parse(buffer);
+			if (result.is_nothing())
+				throw commit_failed(start);
+
+			return result;
+		}
+
+		bool do_recognize(buffer<T>& buffer) const
+		{
+			auto start = buffer.offset();
+			cut_guard<cpparse::buffer<T>> cut(buffer, start);
+
+			if (!m_parser->recognize(buffer))
+				throw commit_failed(start);
+
+			return true;
+		}
+
+	private:
+		subtype_pointer m_parser;
+	};
+
 	//! A parser to "lift" values, i.e. convert them to a more general type.
 	/*! The lift parser takes a parser of type T->M and wraps it, using a function
 	 *  pointer to convert the result type M->R. This allows a parser of one type to
@@ -150,25 +527,38 @@ namespace detail
 		//! The constructor can take a normal function pointer or a lambda.
 		template<typename F>
 		lift_parser(subtype_pointer p, const F& f)
-		: parser<R, T>(), m_parser(p), m_function(f) {}
+		: parser<R, T>(), m_parser(p), m_function(f), m_callback() {}
+
+		//! A named function can also be called from generated code.
+		template<typename F>
+		lift_parser(subtype_pointer p, const named_callback<F>& f)
+		: parser<R, T>(), m_parser(p), m_function(f.function), m_callback(f.name) {}
 
 		lift_parser(const lift_parser&) = default;
 		~lift_parser() = default;
 
-		maybe<R> parse(buffer<T>& buffer) const
+		const char* kind() const { return "lift"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_parser.get()); }
+
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<R> apply(buffer<T>& buffer) const
 		{
 			auto to_lift = m_parser->parse(buffer);
 			if (to_lift.is_nothing())
 				return maybe<R>::nothing;
 
-			auto lifted = m_function(to_lift.from_just());
-			return maybe<R>::just(lifted);
+			return maybe<R>::just(m_function(to_lift.from_just()));
 		}
 
+		bool do_recognize(buffer<T>& buffer) const { return m_parser->recognize(buffer); }
+
 	private:
 		subtype_pointer m_parser;
 		//! The supplied function is passed a reference to the parsed result.
 		std::function<R(const M&)> m_function;
+		std::string m_callback;
 	};
 
 	//! Attempts to match a token with any value in an array.
@@ -183,7 +573,13 @@ namespace detail
 		oneof_parser(const oneof_parser&) = default;
 		~oneof_parser() = default;
 
-		maybe<R> parse(buffer<T>& buffer) const
+		const char* kind() const { return "one_of"; }
+		std::string expected() const { return "one of" + describe_tokens(m_choices); }
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<R> apply(buffer<T>& buffer) const
 		{
 			auto start = buffer.here();
 
@@ -217,7 +613,13 @@ namespace detail
 		noneof_parser(const noneof_parser&) = default;
 		~noneof_parser() = default;
 
-		maybe<R> parse(buffer<T>& buffer) const
+		const char* kind() const { return "none_of"; }
+		std::string expected() const { return "none of" + describe_tokens(m_rejects); }
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<R> apply(buffer<T>& buffer) const
 		{
 			auto start = buffer.here();
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <vector>
+#include <type_traits>
 
 namespace cpparse
 {
@@ -22,5 +24,15 @@ namespace detail
 		parser_traits(const parser_traits&) = delete;
 		~parser_traits() = delete;
 	};
+
+	//! Whether a result points into the buffer's copy of the input, like a "byte_span".
+	/*! Such a result is only valid while its buffer is, so the batch parsers,
+	 *  which make and drop their own buffers, refuse grammars returning one.
+	 */
+	template<typename R>
+	struct refers_to_input : std::false_type {};
+
+	template<typename R>
+	struct refers_to_input<std::vector<R>> : refers_to_input<R> {};
 }
 }
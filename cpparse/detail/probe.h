@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+//! Probes are only compiled in when an instrumentation mode is enabled.
+/*! Without one, parsing has no extra code at all. */
+#if defined(CPPARSE_PROFILE) || defined(CPPARSE_TRACK_ALLOCATIONS) || defined(CPPARSE_TRACE)
+#define CPPARSE_PROBES 1
+#else
+#define CPPARSE_PROBES 0
+#endif
+
+namespace cpparse
+{
+namespace detail
+{
+	class parser_node;
+
+	//! Told about every parser call made on the thread it is attached to.
+	/*! Offsets are positions in the buffer, as given by "buffer::offset". */
+	class parse_probe
+	{
+	public:
+		virtual ~parse_probe() = default;
+
+		virtual void enter(const parser_node& node, std::size_t offset) = 0;
+		virtual void leave(const parser_node& node, std::size_t offset, bool success) = 0;
+
+		//! The buffer moved back from one offset to another.
+		virtual void rewind(std::size_t, std::size_t) {}
+	};
+
+	//! The probes attached to the calling thread.
+	inline std::vector<parse_probe*>& probes()
+	{
+		static thread_local std::vector<parse_probe*> attached;
+		return attached;
+	}
+
+	inline void attach_probe(parse_probe* p) { probes().push_back(p); }
+
+	inline void detach_probe(parse_probe* p)
+	{
+		auto& attached = probes();
+		attached.erase(std::remove(attached.begin(), attached.end(), p), attached.end());
+	}
+
+	//! Tagged parsers are named by their tag; others by their kind, after the name of their caller.
+	inline std::string probe_name(const std::string& tag, const char* kind, const std::string* caller)
+	{
+		if (!tag.empty())
+			return tag;
+
+		if (!caller)
+			return kind;
+
+		return *caller + "/" + kind;
+	}
+
+	inline void probe_rewind(std::size_t from, std::size_t to)
+	{
+		for (auto p : probes())
+			p->rewind(from, to);
+	}
+
+	//! Report one parser call to the probes.
+	/*! If the parser throws, the call is still reported as a failure, so
+	 *  probes can keep track of the call stack.
+	 */
+	class probe_scope
+	{
+	public:
+		probe_scope(const parser_node& n, std::size_t offset)
+		: m_node(n), m_offset(offset), m_open(true)
+		{
+			for (auto p : probes())
+				p->enter(m_node, offset);
+		}
+
+		probe_scope(const probe_scope&) = delete;
+		~probe_scope()
+		{
+			if (m_open)
+				leave(m_offset, false);
+		}
+
+		void leave(std::size_t offset, bool success)
+		{
+			m_open = false;
+
+			auto& attached = probes();
+			for (auto p = attached.rbegin(); p != attached.rend(); ++p)
+				(*p)->leave(m_node, offset, success);
+		}
+
+	private:
+		const parser_node& m_node;
+		std::size_t m_offset;
+		bool m_open;
+	};
+}
+}
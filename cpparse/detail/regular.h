@@ -0,0 +1,82 @@
+#pragma once
+
+#include <bitset>
+#include <vector>
+#include <cstddef>
+
+namespace cpparse
+{
+namespace detail
+{
+	//! A regular expression over bytes, built from a grammar by "parser_node::regular".
+	/*! Expressions are kept in one array and refer to each other by index;
+	 *  -1 stands for a part that is not regular, and makes anything built
+	 *  from it -1 as well.
+	 */
+	class regular_expression
+	{
+	public:
+		enum kind_type { set, concat, alternate, repeat };
+
+		struct node
+		{
+			kind_type kind;
+			std::bitset<256> chars;
+			int first, second;
+			//! A max of "0" means the max is unbounded, as for "many".
+			std::size_t min, max;
+		};
+
+	public:
+		regular_expression() = default;
+		regular_expression(const regular_expression&) = default;
+		~regular_expression() = default;
+
+		//! One byte from "chars".
+		int add_set(const std::bitset<256>& chars)
+		{
+			node n = { set, chars, -1, -1, 0, 0 };
+			return add(n);
+		}
+
+		int add_char(char c)
+		{
+			std::bitset<256> chars;
+			chars.set(static_cast<unsigned char>(c));
+			return add_set(chars);
+		}
+
+		//! "first" followed by "second".
+		int add_concat(int first, int second)
+		{
+			node n = { concat, std::bitset<256>(), first, second, 0, 0 };
+			return (first < 0 || second < 0) ? -1 : add(n);
+		}
+
+		//! Either "first" or "second".
+		int add_alternate(int first, int second)
+		{
+			node n = { alternate, std::bitset<256>(), first, second, 0, 0 };
+			return (first < 0 || second < 0) ? -1 : add(n);
+		}
+
+		int add_repeat(int inner, std::size_t min, std::size_t max)
+		{
+			node n = { repeat, std::bitset<256>(), inner, -1, min, max };
+			return inner < 0 ? -1 : add(n);
+		}
+
+		const std::vector<node>& nodes() const { return m_nodes; }
+
+	private:
+		int add(const node& n)
+		{
+			m_nodes.push_back(n);
+			return static_cast<int>(m_nodes.size()) - 1;
+		}
+
+	private:
+		std::vector<node> m_nodes;
+	};
+}
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <bitset>
+#include <string>
+#include <vector>
+
+#include "regular.h"
+#include "parser.h"
+#include "combinator.h"
+#include "string_parser.h"
+#include "literal.h"
+#include "memo.h"
+
+//! The "regular" hook of each parser, which adds it to a regular expression.
+/*! Kept out of the parsers' own headers, so only "compile_regular" pulls
+ *  in the regular expression builder.
+ */
+namespace cpparse
+{
+namespace detail
+{
+	// ******************************************************************
+	//! Parsers
+	// ******************************************************************
+
+	//! Add a set of tokens to a regular expression. Only characters of text can be added.
+	template<typename R, typename T>
+	int regular_tokens(regular_expression&, const std::vector<R>&, bool, const T*) { return -1; }
+
+	inline int regular_tokens(regular_expression& r, const std::vector<char>& c, bool negate, const std::string*)
+	{
+		std::bitset<256> chars;
+		for (auto ch : c)
+			chars.set(static_cast<unsigned char>(ch));
+
+		return r.add_set(negate ? ~chars : chars);
+	}
+
+	template<typename R, typename T>
+	int oneof_parser<R, T>::regular(regular_expression& r) const { return regular_tokens(r, m_choices, false, static_cast<const T*>(nullptr)); }
+
+	template<typename R, typename T>
+	int noneof_parser<R, T>::regular(regular_expression& r) const { return regular_tokens(r, m_rejects, true, static_cast<const T*>(nullptr)); }
+
+	// ******************************************************************
+	//! Combinators
+	// ******************************************************************
+
+	template<typename R, typename T>
+	int choice_combinator<R, T>::regular(regular_expression& r) const { return r.add_alternate(m_first->regular(r), m_second->regular(r)); }
+
+	template<typename R, typename T, typename M>
+	int sequence_combinator<R, T, M>::regular(regular_expression& r) const { return r.add_concat(m_first->regular(r), m_second->regular(r)); }
+
+	template<typename R, typename T>
+	int merge_combinator<R, T>::regular(regular_expression& r) const { return r.add_concat(m_first->regular(r), m_second->regular(r)); }
+
+	template<typename R, typename T>
+	int many_combinator<R, T>::regular(regular_expression& r) const { return r.add_repeat(m_parser->regular(r), m_min, m_max); }
+
+	// ******************************************************************
+	//! Strings and Characters
+	// ******************************************************************
+
+	inline int string_parser::regular(regular_expression& r) const
+	{
+		if (m_string.empty())
+			return -1;
+
+		int e = r.add_char(m_string[0]);
+		for (std::size_t i = 1; i < m_string.size(); ++i)
+			e = r.add_concat(e, r.add_char(m_string[i]));
+
+		return e;
+	}
+
+	inline int char_parser::regular(regular_expression& r) const { return r.add_char(m_char); }
+
+	inline int char_string_parser::regular(regular_expression& r) const { return m_char->regular(r); }
+
+	// ******************************************************************
+	//! Literals
+	// ******************************************************************
+
+	template<char... Cs>
+	int literal_parser<Cs...>::regular(regular_expression& r) const
+	{
+		int e = r.add_char(text[0]);
+		for (std::size_t i = 1; i < size; ++i)
+			e = r.add_concat(e, r.add_char(text[i]));
+
+		return e;
+	}
+
+	template<class L, class... Ls>
+	int literal_alternatives<L, Ls...>::regular(regular_expression& r)
+	{
+		int e = L().regular(r);
+		return sizeof...(Ls) ? r.add_alternate(e, literal_alternatives<Ls...>::regular(r)) : e;
+	}
+
+	template<class... Ls>
+	int literal_choice_parser<Ls...>::regular(regular_expression& r) const { return alternatives::regular(r); }
+
+	template<char... Bounds>
+	int class_parser<Bounds...>::regular(regular_expression& r) const
+	{
+		std::bitset<256> chars;
+		for (unsigned c = 0; c < 256; ++c)
+			chars[c] = (table[c >> 6] >> (c & 63)) & 1;
+
+		return r.add_set(chars);
+	}
+
+	// ******************************************************************
+	//! Memo
+	// ******************************************************************
+
+	template<typename R, typename T>
+	int memo_parser<R, T>::regular(regular_expression& r) const { return m_parser->regular(r); }
+}
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <bitset>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+#include "image_format.h"
+#include "parser.h"
+#include "combinator.h"
+#include "string_parser.h"
+#include "literal.h"
+#include "numeric.h"
+#include "memo.h"
+#include "dfa.h"
+#include "../accumulator.h"
+
+//! The "save" hook of each parser, which adds it to a grammar image.
+/*! Kept out of the parsers' own headers, so only "save_image" pulls in
+ *  the image writer.
+ */
+namespace cpparse
+{
+namespace detail
+{
+	// ******************************************************************
+	//! Parsers
+	// ******************************************************************
+
+	//! Save a test of the next token against a set. Only characters of text can be saved.
+	template<typename R, typename T>
+	bool save_tokens(image_writer&, const std::vector<R>&, bool, const T*) { return false; }
+
+	inline bool save_tokens(image_writer& w, const std::vector<char>& c, bool negate, const std::string*)
+	{
+		std::bitset<256> chars;
+		for (auto ch : c)
+			chars.set(static_cast<unsigned char>(ch));
+
+		w.emit(op_set, 0, 0, w.set(negate ? ~chars : chars));
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool forward_parser<R, T>::save(image_writer& w) const
+	{
+		if (!image_input<T>::value)
+			return false;
+
+		w.emit(op_forward, 0, 0, w.node(m_target.get()));
+		return true;
+	}
+
+	template<typename T, typename M>
+	bool skip_parser<T, M>::save(image_writer& w) const
+	{
+		if (!image_input<T>::value)
+			return false;
+
+		w.emit(op_skip, 0, 0, w.node(m_parser.get()));
+		return true;
+	}
+
+	template<typename T, typename M, typename P>
+	bool lookahead_parser<T, M, P>::save(image_writer& w) const
+	{
+		if (!image_input<T>::value)
+			return false;
+
+		w.emit(op_lookahead, m_negative ? 1 : 0, 0, w.node(m_parser.get()));
+		return true;
+	}
+
+	//! Only options whose alternate an image can hold: characters, strings, numbers and empty values.
+	template<typename R, typename T>
+	bool option_parser<R, T>::save(image_writer& w) const
+	{
+		std::uint8_t mode = 0;
+		std::uint32_t b = 0, c = 0;
+		if (!image_input<T>::value || !w.constant(m_alternate, mode, b, c))
+			return false;
+
+		w.emit(op_option, mode, 0, w.node(m_parser.get()), b, c);
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool commit_parser<R, T>::save(image_writer& w) const
+	{
+		if (!image_input<T>::value)
+			return false;
+
+		w.emit(op_commit, 0, 0, w.node(m_parser.get()));
+		return true;
+	}
+
+	//! The callback is saved by name, and found again when the image is loaded.
+	template<typename R, typename T, typename M>
+	bool lift_parser<R, T, M>::save(image_writer& w) const
+	{
+		if (m_callback.empty())
+			throw std::logic_error("cpparse::save_image : A lift has no callback name, see \"callback\"!");
+
+		if (!image_input<T>::value)
+			return false;
+
+		w.emit(op_lift, 0, 0, w.node(m_parser.get()), 0, w.callback(m_callback));
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool oneof_parser<R, T>::save(image_writer& w) const { return save_tokens(w, m_choices, false, static_cast<const T*>(nullptr)); }
+
+	template<typename R, typename T>
+	bool noneof_parser<R, T>::save(image_writer& w) const { return save_tokens(w, m_rejects, true, static_cast<const T*>(nullptr)); }
+
+	// ******************************************************************
+	//! Combinators
+	// ******************************************************************
+
+	//! How a merge or "many" of R results is combined in an image.
+	template<typename R>
+	struct image_accumulation
+	{
+		static const std::uint8_t value = std::is_same<typename accumulator<R>::result_type, std::string>::value ? accumulate_text : accumulate_list;
+	};
+
+	template<typename R, typename T>
+	bool choice_combinator<R, T>::save(image_writer& w) const
+	{
+		if (!image_input<T>::value)
+			return false;
+
+		w.emit(op_choice, 0, 0, w.node(m_first.get()), w.node(m_second.get()));
+		return true;
+	}
+
+	template<typename R, typename T, typename M>
+	bool sequence_combinator<R, T, M>::save(image_writer& w) const
+	{
+		if (!image_input<T>::value)
+			return false;
+
+		w.emit(op_sequence, 0, 0, w.node(m_first.get()), w.node(m_second.get()));
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool merge_combinator<R, T>::save(image_writer& w) const
+	{
+		if (!image_input<T>::value)
+			return false;
+
+		w.emit(op_merge, image_accumulation<R>::value, 0, w.node(m_first.get()), w.node(m_second.get()));
+		return true;
+	}
+
+	template<typename R, typename T>
+	bool many_combinator<R, T>::save(image_writer& w) const
+	{
+		if (!image_input<T>::value || m_min > UINT32_MAX || m_max > UINT32_MAX)
+			return false;
+
+		w.emit(op_many, image_accumulation<R>::value, 0, w.node(m_parser.get()), static_cast<std::uint32_t>(m_min), static_cast<std::uint32_t>(m_max));
+		return true;
+	}
+
+	//! Each statement is saved with its tag, and the callback by name.
+	template<typename R, typename T, typename M>
+	bool block_combinator<R, T, M>::save(image_writer& w) const
+	{
+		if (m_callback.empty())
+			throw std::logic_error("cpparse::save_image : A block has no callback name, see \"callback\"!");
+
+		if (!image_input<T>::value)
+			return false;
+
+		std::vector<std::uint32_t> statements;
+		for (auto& p : m_statements)
+		{
+			statements.push_back(w.node(p.get()));
+			statements.push_back(w.text(p->tag()));
+			statements.push_back(static_cast<std::uint32_t>(p->tag().size()));
+		}
+
+		w.emit(op_block, 0, 0, w.words(statements), static_cast<std::uint32_t>(m_statements.size()), w.callback(m_callback));
+		return true;
+	}
+
+	// ******************************************************************
+	//! Strings and Characters
+	// ******************************************************************
+
+	inline bool string_parser::save(image_writer& w) const
+	{
+		w.emit(op_text, 0, 0, w.text(m_string), static_cast<std::uint32_t>(m_string.size()));
+		return true;
+	}
+
+	inline bool char_parser::save(image_writer& w) const
+	{
+		w.emit(op_char, 0, 0, static_cast<unsigned char>(m_char));
+		return true;
+	}
+
+	// ******************************************************************
+	//! Literals
+	// ******************************************************************
+
+	template<char... Cs>
+	bool literal_parser<Cs...>::save(image_writer& w) const
+	{
+		w.emit(op_text, 0, 0, w.bytes(text, size), static_cast<std::uint32_t>(size));
+		return true;
+	}
+
+	//! An (offset, length) pair per literal, in order.
+	template<class L, class... Ls>
+	void literal_alternatives<L, Ls...>::save(image_writer& w, std::vector<std::uint32_t>& texts)
+	{
+		texts.push_back(w.bytes(L::text, L::size));
+		texts.push_back(static_cast<std::uint32_t>(L::size));
+
+		literal_alternatives<Ls...>::save(w, texts);
+	}
+
+	template<class... Ls>
+	bool literal_choice_parser<Ls...>::save(image_writer& w) const
+	{
+		std::vector<std::uint32_t> texts;
+		alternatives::save(w, texts);
+
+		w.emit(op_texts, 0, 0, w.words(texts), sizeof...(Ls));
+		return true;
+	}
+
+	template<char... Bounds>
+	bool class_parser<Bounds...>::save(image_writer& w) const
+	{
+		std::bitset<256> chars;
+		for (unsigned c = 0; c < 256; ++c)
+			chars[c] = (table[c >> 6] >> (c & 63)) & 1;
+
+		w.emit(op_set, 0, 0, w.set(chars));
+		return true;
+	}
+
+	// ******************************************************************
+	//! Numbers
+	// ******************************************************************
+
+	template<typename T>
+	bool integer_parser<T>::save(image_writer& w) const
+	{
+		std::uint16_t flags = (m_sign ? integer_sign : 0) | (m_hex ? integer_hex : 0) | (std::is_signed<T>::value ? integer_signed : 0);
+		w.emit(op_integer, sizeof(T), flags);
+		return true;
+	}
+
+	template<typename T>
+	bool floating_parser<T>::save(image_writer& w) const
+	{
+		w.emit(op_floating, std::is_same<T, float>::value ? 0 : (std::is_same<T, double>::value ? 1 : 2), 0);
+		return true;
+	}
+
+	// ******************************************************************
+	//! Memo
+	// ******************************************************************
+
+	template<typename R, typename T>
+	bool memo_parser<R, T>::save(image_writer& w) const
+	{
+		if (!image_input<T>::value)
+			return false;
+
+		w.emit(op_forward, 0, 0, w.node(m_parser.get()));
+		return true;
+	}
+
+	// ******************************************************************
+	//! Automata
+	// ******************************************************************
+
+	inline bool dfa_parser::save(image_writer& w) const
+	{
+		auto image = m_dfa.write();
+		w.emit(op_dfa, 0, 0, w.bytes(image.data(), image.size()), static_cast<std::uint32_t>(image.size()));
+		return true;
+	}
+}
+}
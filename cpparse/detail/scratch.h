@@ -0,0 +1,180 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+
+namespace cpparse
+{
+namespace detail
+{
+	//! Empty a scratch object for its next use, keeping whatever memory it has.
+	template<typename O>
+	void scratch_clear(O& o) { o = O(); }
+
+	template<typename C, typename Tr, typename A>
+	void scratch_clear(std::basic_string<C, Tr, A>& s) { s.clear(); }
+
+	template<typename V, typename A>
+	void scratch_clear(std::vector<V, A>& v) { v.clear(); }
+
+	//! A block's parser always binds the same tags, so the keys are kept and only the values cleared.
+	template<typename K, typename V, typename C, typename A>
+	void scratch_clear(std::map<K, V, C, A>& m)
+	{
+		for (auto& e : m)
+			scratch_clear(e.second);
+	}
+
+	//! A unique address for each type, to check that a list holds the type asked for.
+	template<typename O>
+	const void* scratch_type()
+	{
+		static const char id = 0;
+		return &id;
+	}
+
+	//! The objects kept for one parser.
+	class scratch_list
+	{
+	public:
+		scratch_list()
+		: m_type(nullptr) {}
+
+		scratch_list(const scratch_list&) = delete;
+		~scratch_list() = default;
+
+		template<typename O>
+		O* take()
+		{
+			//! A parser freed and another made at its address may want another type.
+			if (m_type != scratch_type<O>())
+			{
+				m_all.clear();
+				m_free.clear();
+				m_type = scratch_type<O>();
+			}
+
+			if (m_free.empty())
+			{
+				std::shared_ptr<O> created = std::make_shared<O>();
+				m_all.push_back(created);
+				return created.get();
+			}
+
+			auto o = static_cast<O*>(m_free.back());
+			m_free.pop_back();
+			return o;
+		}
+
+		template<typename O>
+		void give(O* o)
+		{
+			scratch_clear(*o);
+			m_free.push_back(o);
+		}
+
+		std::size_t size() const { return m_all.size(); }
+
+	private:
+		const void* m_type;
+		std::vector<std::shared_ptr<void>> m_all;
+		std::vector<void*> m_free;
+	};
+
+	//! Working objects that parsers borrow during a parse, and give back for the next one.
+	/*! Each parser has its own list of objects, and takes one per active
+	 *  call, so recursion takes several. Objects are kept until the scratch
+	 *  space is cleared, so once every list has grown to the deepest
+	 *  recursion seen, borrowing allocates nothing.
+	 *
+	 *  A copy starts out empty, as the objects belong to calls on one thread.
+	 */
+	class scratch_space
+	{
+	public:
+		scratch_space() { forget(); }
+		scratch_space(const scratch_space&) { forget(); }
+		scratch_space& operator=(const scratch_space&) { return *this; }
+		~scratch_space() = default;
+
+		//! A grammar has few parsers that borrow, so most lookups hit the cache and skip the hash.
+		scratch_list& list(const void* owner)
+		{
+			auto& cached = m_cache[(reinterpret_cast<std::uintptr_t>(owner) >> 4) % cache_size];
+			if (cached.owner != owner)
+			{
+				cached.owner = owner;
+				cached.list = &m_lists[owner];
+			}
+
+			return *cached.list;
+		}
+
+		//! How many objects are kept, free or in use.
+		std::size_t objects() const
+		{
+			std::size_t n = 0;
+			for (auto& l : m_lists)
+				n += l.second.size();
+
+			return n;
+		}
+
+		//! Free every object, e.g. after parsing with a grammar that is no longer used.
+		/*! Only call this between parses. */
+		void clear()
+		{
+			m_lists.clear();
+			forget();
+		}
+
+	private:
+		static const std::size_t cache_size = 64;
+
+		void forget()
+		{
+			for (auto& c : m_cache)
+				c = cache_entry();
+		}
+
+	private:
+		struct cache_entry
+		{
+			const void* owner = nullptr;
+			scratch_list* list = nullptr;
+		};
+
+		std::unordered_map<const void*, scratch_list> m_lists;
+		cache_entry m_cache[cache_size];
+	};
+
+	//! Borrow an object from a scratch space for the lifetime of the lease.
+	/*! Without a scratch space, the lease holds a fresh object of its own. */
+	template<typename O>
+	class scratch_lease
+	{
+	public:
+		scratch_lease(scratch_space* s, const void* owner)
+		: m_list(s ? &s->list(owner) : nullptr), m_local(), m_object(m_list ? m_list->template take<O>() : &m_local) {}
+
+		scratch_lease(const scratch_lease&) = delete;
+		~scratch_lease()
+		{
+			if (m_list)
+				m_list->give(m_object);
+		}
+
+		O& operator*() const { return *m_object; }
+		O* operator->() const { return m_object; }
+
+	private:
+		scratch_list* m_list;
+		O m_local;
+		O* m_object;
+	};
+}
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "parallel.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	//! The characters that give s-expression text its structure.
+	/*! Strings have no escapes, matching a string rule like
+	 *  ( '"' >> many(none_of("\"")) >> '"' ).
+	 */
+	struct sexpr_syntax
+	{
+		char open;
+		char close;
+		char quote;
+		std::string spaces;
+
+		sexpr_syntax()
+		: open('('), close(')'), quote('"'), spaces(" \t\r\n") {}
+	};
+
+	//! The effect of scanning one chunk of text from a given starting state.
+	struct sexpr_summary
+	{
+		bool in_string;	//!< Whether the chunk ends inside a string.
+		long depth;		//!< Change in paren depth over the chunk.
+		long min_depth;	//!< Lowest depth reached, relative to the start.
+	};
+
+	//! Finds the elements of a list without parsing them.
+	/*! The text between the parens is cut into chunks that are scanned in
+	 *  parallel. Since a chunk may start inside a string, each one is first
+	 *  scanned twice, once assuming each lexical state. A short pass over the
+	 *  chunk summaries then fixes the real state and depth at every chunk
+	 *  start, and a second parallel pass records where the top-level
+	 *  elements begin and end.
+	 */
+	class sexpr_scanner
+	{
+	public:
+		typedef std::pair<std::size_t, std::size_t> range;
+
+		enum char_class { other_char, open_char, close_char, quote_char, space_char };
+
+	public:
+		sexpr_scanner(const sexpr_syntax& s)
+		{
+			for (auto& c : m_classes)
+				c = other_char;
+
+			for (auto c : s.spaces)
+				m_classes[static_cast<unsigned char>(c)] = space_char;
+
+			m_classes[static_cast<unsigned char>(s.open)] = open_char;
+			m_classes[static_cast<unsigned char>(s.close)] = close_char;
+			m_classes[static_cast<unsigned char>(s.quote)] = quote_char;
+		}
+
+		sexpr_scanner(const sexpr_scanner&) = default;
+		~sexpr_scanner() = default;
+
+		char_class classify(char c) const { return m_classes[static_cast<unsigned char>(c)]; }
+
+		sexpr_summary summarize(const char* begin, const char* end, bool in_string) const
+		{
+			sexpr_summary s = { in_string, 0, 0 };
+			for (auto p = begin; p != end; ++p)
+			{
+				auto c = classify(*p);
+				if (c == quote_char)
+					s.in_string = !s.in_string;
+				else if (s.in_string)
+					continue;
+				else if (c == open_char)
+					s.depth += 1;
+				else if (c == close_char && --s.depth < s.min_depth)
+					s.min_depth = s.depth;
+			}
+
+			return s;
+		}
+
+		//! Find the elements of the list spanning [begin, end), parens included.
+		/*! Element ranges are relative to "begin". Returns false if the text is
+		 *  not a single list of space-separated elements, e.g. unbalanced, empty,
+		 *  or with spaces just inside the parens.
+		 */
+		bool split(const char* begin, const char* end, std::size_t threads, std::vector<range>& elements) const
+		{
+			if (end - begin < 3 || classify(*begin) != open_char || classify(*(end - 1)) != close_char)
+				return false;
+
+			const char* first = begin + 1;
+			const char* last = end - 1;
+			if (classify(*first) == space_char || classify(*(last - 1)) == space_char)
+				return false;
+
+			if (!threads)
+				threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+			std::size_t length = last - first;
+			std::size_t count = std::max<std::size_t>(1, std::min(length / 4096 + 1, threads * 4));
+
+			std::vector<const char*> bounds;
+			for (std::size_t k = 0; k <= count; ++k)
+				bounds.push_back(first + length * k / count);
+
+			//! Scan every chunk under both starting states.
+			std::vector<sexpr_summary> summaries(count * 2);
+			parallel_for(count, threads,
+				[&](std::size_t c)
+				{
+					summaries[c * 2] = summarize(bounds[c], bounds[c + 1], false);
+					summaries[c * 2 + 1] = summarize(bounds[c], bounds[c + 1], true);
+				});
+
+			//! Choose the real summary of each chunk, based on the one before it.
+			std::vector<sexpr_summary> starts(count + 1);
+			starts[0] = { false, 0, 0 };
+			for (std::size_t c = 0; c < count; ++c)
+			{
+				auto& s = summaries[c * 2 + (starts[c].in_string ? 1 : 0)];
+				if (starts[c].depth + s.min_depth < 0)
+					return false;
+
+				starts[c + 1] = { s.in_string, starts[c].depth + s.depth, 0 };
+			}
+
+			if (starts[count].in_string || starts[count].depth != 0)
+				return false;
+
+			//! Record where each top-level element starts and ends.
+			std::vector<std::vector<std::size_t>> edges(count);
+			parallel_for(count, threads,
+				[&](std::size_t c)
+				{
+					bool in_string = starts[c].in_string;
+					long depth = starts[c].depth;
+
+					const char* p = bounds[c];
+					bool separated = (p == first) || (!in_string && !depth && classify(*(p - 1)) == space_char);
+
+					for (; p != bounds[c + 1]; ++p)
+					{
+						auto k = classify(*p);
+						bool separator = (!in_string && !depth && k == space_char);
+						if (separator != separated)
+							edges[c].push_back(p - begin);
+
+						separated = separator;
+						if (k == quote_char)
+							in_string = !in_string;
+						else if (!in_string && k == open_char)
+							depth += 1;
+						else if (!in_string && k == close_char)
+							depth -= 1;
+					}
+				});
+
+			std::vector<std::size_t> all;
+			for (auto& e : edges)
+				all.insert(all.end(), e.begin(), e.end());
+			all.push_back(last - begin);
+
+			for (std::size_t i = 0; i + 1 < all.size(); i += 2)
+				elements.push_back(range(all[i], all[i + 1]));
+
+			return true;
+		}
+
+	private:
+		char_class m_classes[256];
+	};
+}
+}
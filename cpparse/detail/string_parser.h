@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "parser.h"
+#include "../callbacks.h"
 #include "../maybe.h"
 #include "../buffer.h"
 
@@ -21,7 +22,13 @@ namespace detail
 		string_parser(const string_parser&) = delete;
 		~string_parser() = default;
 
-		maybe<std::string> parse(buffer<std::string>& buffer) const
+		const char* kind() const { return "string"; }
+		std::string expected() const { return quote(m_string); }
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<std::string> apply(buffer<std::string>& buffer) const
 		{
 			auto start = buffer.here();
 
@@ -38,6 +45,24 @@ namespace detail
 			return maybe<std::string>::just(m_string);
 		}
 
+		//! Compares without copying the string.
+		bool do_recognize(buffer<std::string>& buffer) const
+		{
+			auto start = buffer.here();
+
+			for (auto& ch : m_string)
+			{
+				auto next = buffer.next();
+				if (next.is_just() && next.from_just() == ch)
+					continue;
+
+				buffer.rewind(start);
+				return false;
+			}
+
+			return true;
+		}
+
 	private:
 		std::string m_string;
 	};
@@ -53,7 +78,13 @@ namespace detail
 		char_parser(const char_parser&) = delete;
 		~char_parser() = default;
 
-		maybe<char> parse(buffer<std::string>& buffer) const
+		const char* kind() const { return "char"; }
+		std::string expected() const { return quote(std::string(1, m_char), '\''); }
+		int regular(regular_expression& r) const;
+		bool generate(generator& g) const;
+		bool save(image_writer& w) const;
+
+		maybe<char> apply(buffer<std::string>& buffer) const
 		{
 			auto start = buffer.here();
 
@@ -68,5 +99,24 @@ namespace detail
 	private:
 		char m_char;
 	};
+
+	//! Convert a character to a string of that one character.
+	/*! Unlike other lifts, its result is the text it matched, so it can be
+	 *  part of a regular parser.
+	 */
+	class char_string_parser : public lift_parser<std::string, std::string, char>
+	{
+	public:
+		char_string_parser(typename parser_traits<parser<char, std::string>>::type_pointer p)
+		: lift_parser<std::string, std::string, char>(p, callback("cpparse::callbacks::char_string", &callbacks::char_string)), m_char(p) {}
+
+		char_string_parser(const char_string_parser&) = default;
+		~char_string_parser() = default;
+
+		int regular(regular_expression& r) const;
+
+	private:
+		typename parser_traits<parser<char, std::string>>::type_pointer m_char;
+	};
 }
 }
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "parser.h"
+#include "../maybe.h"
+#include "../buffer.h"
+#include "parser_traits.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	//! What may appear between tokens: whitespace characters, and line and block comments.
+	class trivia_spec
+	{
+	public:
+		struct block
+		{
+			std::string open, close;
+			bool nested;
+		};
+
+	public:
+		trivia_spec(const std::string& spaces = " \t\r\n")
+		: m_spaces(spaces) {}
+
+		trivia_spec(const trivia_spec&) = default;
+		~trivia_spec() = default;
+
+		//! A comment from "start" to the end of the line.
+		trivia_spec& line_comment(const std::string& start)
+		{
+			if (!start.empty())
+				m_lines.push_back(start);
+
+			return *this;
+		}
+
+		//! A comment from "open" to "close". Nested comments need a matching close for every open.
+		trivia_spec& block_comment(const std::string& open, const std::string& close, bool nested = false)
+		{
+			if (!open.empty() && !close.empty())
+				m_blocks.push_back(block{ open, close, nested });
+
+			return *this;
+		}
+
+		const std::string& spaces() const { return m_spaces; }
+		const std::vector<std::string>& line_comments() const { return m_lines; }
+		const std::vector<block>& block_comments() const { return m_blocks; }
+
+	private:
+		std::string m_spaces;
+		std::vector<std::string> m_lines;
+		std::vector<block> m_blocks;
+	};
+
+	//! Skips trivia by scanning characters directly, rather than through parsers.
+	/*! A table says which characters are whitespace and which can start a
+	 *  comment, so most positions cost one lookup. Runs of whitespace are
+	 *  scanned 16 bytes at a time with SSE2, when there are at most 8
+	 *  whitespace characters. An unterminated block comment is not skipped,
+	 *  so the token parser after it fails there.
+	 */
+	class trivia_scanner
+	{
+	public:
+		trivia_scanner(const trivia_spec& spec)
+		: m_spec(spec)
+		{
+			std::memset(m_class, 0, sizeof(m_class));
+
+			for (unsigned char c : spec.spaces())
+				m_class[c] |= space;
+			for (auto& l : spec.line_comments())
+				m_class[static_cast<unsigned char>(l[0])] |= comment;
+			for (auto& b : spec.block_comments())
+				m_class[static_cast<unsigned char>(b.open[0])] |= comment;
+		}
+
+		trivia_scanner(const trivia_scanner&) = default;
+		~trivia_scanner() = default;
+
+		//! The end of the trivia that starts at "p".
+		const char* skip(const char* p, const char* end) const
+		{
+			while (p != end)
+			{
+				p = skip_spaces(p, end);
+				if (p == end || !(m_class[static_cast<unsigned char>(*p)] & comment))
+					break;
+
+				auto after = skip_comment(p, end);
+				if (after == p)
+					break;
+
+				p = after;
+			}
+
+			return p;
+		}
+
+		//! How many characters from "p", where "skip" stopped, it looked at, counting the end as one.
+		/*! That is the character at "p", the comment openings it was compared
+		 *  with, and the rest of the input for an unterminated block comment.
+		 */
+		std::size_t lookahead(const char* p, const char* end) const
+		{
+			std::size_t n = 1;
+			if (p == end || !(m_class[static_cast<unsigned char>(*p)] & comment))
+				return n;
+
+			for (auto& l : m_spec.line_comments())
+				n = std::max(n, l.size());
+
+			for (auto& b : m_spec.block_comments())
+			{
+				if (starts_with(p, end, b.open))
+					return (end - p) + 1;
+
+				n = std::max(n, b.open.size());
+			}
+
+			return n;
+		}
+
+	private:
+		enum { space = 1, comment = 2 };
+
+		bool is_space(char c) const { return (m_class[static_cast<unsigned char>(c)] & space) != 0; }
+
+		static bool starts_with(const char* p, const char* end, const std::string& s)
+		{
+			return static_cast<std::size_t>(end - p) >= s.size() && !std::memcmp(p, s.data(), s.size());
+		}
+
+		const char* skip_spaces(const char* p, const char* end) const
+		{
+			//! Most gaps are a single character, so do not set up a vector scan for them.
+			if (p == end || !is_space(*p))
+				return p;
+			++p;
+
+#if defined(__SSE2__)
+			auto& spaces = m_spec.spaces();
+			if (spaces.size() <= 8)
+			{
+				__m128i targets[8];
+				for (std::size_t i = 0; i < spaces.size(); ++i)
+					targets[i] = _mm_set1_epi8(spaces[i]);
+
+				while (end - p >= 16)
+				{
+					__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+					__m128i hit = _mm_setzero_si128();
+					for (std::size_t i = 0; i < spaces.size(); ++i)
+						hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, targets[i]));
+
+					unsigned others = ~static_cast<unsigned>(_mm_movemask_epi8(hit)) & 0xffff;
+					if (others)
+						return p + first_bit(others);
+
+					p += 16;
+				}
+			}
+#endif
+			while (p != end && is_space(*p))
+				++p;
+
+			return p;
+		}
+
+		static unsigned first_bit(unsigned mask)
+		{
+#if defined(__GNUC__)
+			return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+			unsigned i = 0;
+			while (!(mask & 1))
+			{
+				mask >>= 1;
+				i += 1;
+			}
+			return i;
+#endif
+		}
+
+		//! The end of the comment at "p", or "p" if there is none.
+		const char* skip_comment(const char* p, const char* end) const
+		{
+			for (auto& l : m_spec.line_comments())
+			{
+				if (!starts_with(p, end, l))
+					continue;
+
+				auto newline = static_cast<const char*>(std::memchr(p + l.size(), '\n', end - p - l.size()));
+				return newline ? newline + 1 : end;
+			}
+
+			for (auto& b : m_spec.block_comments())
+			{
+				if (!starts_with(p, end, b.open))
+					continue;
+
+				auto q = p + b.open.size();
+				if (!b.nested)
+				{
+					while ((q = static_cast<const char*>(std::memchr(q, b.close[0], end - q))))
+					{
+						if (starts_with(q, end, b.close))
+							return q + b.close.size();
+						++q;
+					}
+
+					return p;
+				}
+
+				std::size_t depth = 1;
+				while (q != end)
+				{
+					if (starts_with(q, end, b.close))
+					{
+						q += b.close.size();
+						if (!--depth)
+							return q;
+					}
+					else if (starts_with(q, end, b.open))
+					{
+						q += b.open.size();
+						depth += 1;
+					}
+					else
+						++q;
+				}
+
+				return p;
+			}
+
+			return p;
+		}
+
+	private:
+		trivia_spec m_spec;
+		unsigned char m_class[256];
+	};
+
+	//! Move the buffer past the trivia at its position.
+	inline void skip_trivia(buffer<std::string>& buffer, const trivia_scanner& scanner)
+	{
+		auto& data = buffer.data();
+		auto here = data.data() + buffer.offset();
+		auto end = data.data() + data.size();
+
+		auto after = scanner.skip(here, end);
+		buffer.examine(buffer.offset() + (after - here) + scanner.lookahead(after, end));
+		buffer.advance(after - here);
+	}
+
+	//! A token: the inner parser, followed by any trivia.
+	/*! The trivia is skipped by the scanner, not by parsers, so a gap costs
+	 *  no parser calls.
+	 */
+	template<typename R>
+	class lexeme_parser : public parser<R, std::string>
+	{
+	private:
+		typedef typename parser_traits<parser<R, std::string>>::type_pointer subtype_pointer;
+
+	public:
+		lexeme_parser(subtype_pointer p, std::shared_ptr<const trivia_scanner> s)
+		: parser<R, std::string>(), m_parser(p), m_scanner(s) {}
+
+		lexeme_parser(const lexeme_parser&) = default;
+		~lexeme_parser() = default;
+
+		const char* kind() const { return "lexeme"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_parser.get()); }
+
+		maybe<R> apply(buffer<std::string>& buffer) const
+		{
+			auto result = m_parser->parse(buffer);
+			if (result.is_just())
+				skip_trivia(buffer, *m_scanner);
+
+			return result;
+		}
+
+		bool do_recognize(buffer<std::string>& buffer) const
+		{
+			if (!m_parser->recognize(buffer))
+				return false;
+
+			skip_trivia(buffer, *m_scanner);
+			return true;
+		}
+
+	private:
+		subtype_pointer m_parser;
+		std::shared_ptr<const trivia_scanner> m_scanner;
+	};
+
+	//! Skip trivia on its own, e.g. before the first token. Always succeeds, with an empty string.
+	class trivia_parser : public parser<std::string, std::string>
+	{
+	public:
+		trivia_parser(std::shared_ptr<const trivia_scanner> s)
+		: parser<std::string, std::string>(), m_scanner(s) {}
+
+		trivia_parser(const trivia_parser&) = default;
+		~trivia_parser() = default;
+
+		const char* kind() const { return "trivia"; }
+
+		maybe<std::string> apply(buffer<std::string>& buffer) const
+		{
+			skip_trivia(buffer, *m_scanner);
+			return maybe<std::string>::just(std::string());
+		}
+
+	private:
+		std::shared_ptr<const trivia_scanner> m_scanner;
+	};
+}
+}
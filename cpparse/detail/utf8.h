@@ -0,0 +1,426 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "parser.h"
+#include "../maybe.h"
+#include "../buffer.h"
+#include "parser_traits.h"
+#include "unicode_tables.h"
+
+namespace cpparse
+{
+namespace detail
+{
+	// ******************************************************************
+	//! Decoding
+	// ******************************************************************
+
+	//! Decode the sequence at "p" into "cp", returning its length, or 0 if it is not valid UTF-8.
+	/*! Overlong forms, surrogates and values past U+10FFFF are all invalid. */
+	inline std::size_t decode_utf8(const char* p, const char* end, char32_t& cp)
+	{
+		auto s = reinterpret_cast<const unsigned char*>(p);
+		std::size_t available = end - p;
+		if (!available)
+			return 0;
+
+		if (s[0] < 0x80)
+		{
+			cp = s[0];
+			return 1;
+		}
+
+		std::size_t length;
+		char32_t min;
+		if ((s[0] & 0xE0) == 0xC0)
+		{
+			length = 2;
+			min = 0x80;
+			cp = s[0] & 0x1F;
+		}
+		else if ((s[0] & 0xF0) == 0xE0)
+		{
+			length = 3;
+			min = 0x800;
+			cp = s[0] & 0x0F;
+		}
+		else if ((s[0] & 0xF8) == 0xF0)
+		{
+			length = 4;
+			min = 0x10000;
+			cp = s[0] & 0x07;
+		}
+		else
+			return 0;
+
+		if (available < length)
+			return 0;
+
+		for (std::size_t i = 1; i < length; ++i)
+		{
+			if ((s[i] & 0xC0) != 0x80)
+				return 0;
+
+			cp = (cp << 6) | (s[i] & 0x3F);
+		}
+
+		if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+			return 0;
+
+		return length;
+	}
+
+	//! Decode the sequence at "p", already known to be valid UTF-8, into "cp", returning its length.
+	inline std::size_t decode_valid_utf8(const char* p, char32_t& cp)
+	{
+		auto s = reinterpret_cast<const unsigned char*>(p);
+		if (s[0] < 0x80)
+		{
+			cp = s[0];
+			return 1;
+		}
+
+		if (s[0] < 0xE0)
+		{
+			cp = (char32_t(s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+			return 2;
+		}
+
+		if (s[0] < 0xF0)
+		{
+			cp = (char32_t(s[0] & 0x0F) << 12) | (char32_t(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+			return 3;
+		}
+
+		cp = (char32_t(s[0] & 0x07) << 18) | (char32_t(s[1] & 0x3F) << 12) | (char32_t(s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+		return 4;
+	}
+
+	inline void encode_utf8(char32_t cp, std::string& out)
+	{
+		if (cp < 0x80)
+			out += static_cast<char>(cp);
+		else if (cp < 0x800)
+		{
+			out += static_cast<char>(0xC0 | (cp >> 6));
+			out += static_cast<char>(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000)
+		{
+			out += static_cast<char>(0xE0 | (cp >> 12));
+			out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (cp & 0x3F));
+		}
+		else
+		{
+			out += static_cast<char>(0xF0 | (cp >> 18));
+			out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (cp & 0x3F));
+		}
+	}
+
+	//! The end of the ASCII run at "p".
+	/*! 16 bytes are checked at once with SSE2, or 8 as a 64-bit word without it. */
+	inline const char* skip_ascii(const char* p, const char* end)
+	{
+#if defined(__SSE2__)
+		while (end - p >= 16)
+		{
+			unsigned high = static_cast<unsigned>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+			if (high)
+			{
+#if defined(__GNUC__)
+				return p + __builtin_ctz(high);
+#else
+				break;
+#endif
+			}
+
+			p += 16;
+		}
+#else
+		while (end - p >= 8)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, p, sizeof(word));
+			if (word & 0x8080808080808080ULL)
+				break;
+
+			p += 8;
+		}
+#endif
+		while (p != end && !(*p & 0x80))
+			++p;
+
+		return p;
+	}
+
+	//! The first byte of "[p, end)" that is not part of valid UTF-8, or "end".
+	/*! Text is mostly ASCII, which is skipped a block at a time; only the
+	 *  other sequences are decoded one by one.
+	 */
+	inline const char* validate_utf8(const char* p, const char* end)
+	{
+		char32_t cp;
+		for (;;)
+		{
+			p = skip_ascii(p, end);
+			if (p == end)
+				return end;
+
+			auto length = decode_utf8(p, end, cp);
+			if (!length)
+				return p;
+
+			p += length;
+		}
+	}
+
+	// ******************************************************************
+	//! Character classes
+	// ******************************************************************
+
+	//! A set of code points, as sorted ranges, with a bitmap for ASCII.
+	/*! Most input is ASCII, so most lookups are one bit test; the rest are a
+	 *  binary search of the ranges.
+	 */
+	class codepoint_set
+	{
+	public:
+		codepoint_set()
+		: m_ascii{ 0, 0 } {}
+
+		codepoint_set(const codepoint_range* r, std::size_t n)
+		: m_ascii{ 0, 0 }, m_ranges(r, r + n)
+		{
+			normalize();
+		}
+
+		codepoint_set(const codepoint_set&) = default;
+		~codepoint_set() = default;
+
+		static codepoint_set letter() { std::size_t n; auto r = letter_ranges(n); return codepoint_set(r, n); }
+		static codepoint_set digit() { std::size_t n; auto r = digit_ranges(n); return codepoint_set(r, n); }
+		static codepoint_set space() { std::size_t n; auto r = space_ranges(n); return codepoint_set(r, n); }
+
+		static codepoint_set range(char32_t first, char32_t last)
+		{
+			codepoint_range r = { first, last };
+			return codepoint_set(&r, 1);
+		}
+
+		//! Every code point in the UTF-8 text "s". Invalid bytes are ignored.
+		static codepoint_set of(const std::string& s)
+		{
+			std::vector<codepoint_range> ranges;
+
+			char32_t cp;
+			for (const char* p = s.data(), *end = p + s.size(); p != end; )
+			{
+				auto length = decode_utf8(p, end, cp);
+				if (length)
+					ranges.push_back(codepoint_range{ cp, cp });
+
+				p += std::max<std::size_t>(length, 1);
+			}
+
+			return codepoint_set(ranges.data(), ranges.size());
+		}
+
+		codepoint_set operator|(const codepoint_set& other) const
+		{
+			codepoint_set united(*this);
+			united.m_ranges.insert(united.m_ranges.end(), other.m_ranges.begin(), other.m_ranges.end());
+			united.normalize();
+			return united;
+		}
+
+		bool contains(char32_t cp) const
+		{
+			if (cp < 128)
+				return (m_ascii[cp >> 6] >> (cp & 63)) & 1;
+
+			auto after = std::upper_bound(m_ranges.begin(), m_ranges.end(), cp,
+				[](char32_t c, const codepoint_range& r) { return c < r.first; });
+
+			return after != m_ranges.begin() && cp <= (after - 1)->last;
+		}
+
+		const std::vector<codepoint_range>& ranges() const { return m_ranges; }
+
+	private:
+		//! Sort and merge the ranges, and rebuild the ASCII bitmap.
+		void normalize()
+		{
+			std::sort(m_ranges.begin(), m_ranges.end(),
+				[](const codepoint_range& a, const codepoint_range& b) { return a.first < b.first; });
+
+			std::vector<codepoint_range> merged;
+			for (auto& r : m_ranges)
+			{
+				if (r.first > r.last)
+					continue;
+
+				if (!merged.empty() && r.first <= merged.back().last + 1)
+					merged.back().last = std::max(merged.back().last, r.last);
+				else
+					merged.push_back(r);
+			}
+
+			m_ranges.swap(merged);
+
+			m_ascii[0] = m_ascii[1] = 0;
+			for (auto& r : m_ranges)
+			{
+				for (char32_t cp = r.first; cp <= r.last && cp < 128; ++cp)
+					m_ascii[cp >> 6] |= std::uint64_t(1) << (cp & 63);
+			}
+		}
+
+	private:
+		std::uint64_t m_ascii[2];
+		std::vector<codepoint_range> m_ranges;
+	};
+
+	// ******************************************************************
+	//! Parsers
+	// ******************************************************************
+
+	//! Parse one UTF-8 encoded code point in a set, from text input.
+	/*! The sequence is decoded in place, and the buffer moves past all of
+	 *  its bytes, so offsets stay byte offsets. Invalid UTF-8 fails. Inside
+	 *  a "utf8" parser, the input is not checked again.
+	 */
+	class codepoint_parser : public parser<char32_t, std::string>
+	{
+	public:
+		//! "any" accepts every code point, without looking at "set".
+		codepoint_parser(const codepoint_set& set, const std::string& description, bool any = false)
+		: parser<char32_t, std::string>(), m_set(set), m_description(description), m_any(any) {}
+
+		codepoint_parser(const codepoint_parser&) = default;
+		~codepoint_parser() = default;
+
+		const char* kind() const { return "codepoint"; }
+		std::string expected() const { return m_description; }
+
+		maybe<char32_t> apply(buffer<std::string>& buffer) const
+		{
+			auto& data = buffer.data();
+			const char* p = data.data() + buffer.offset();
+
+			char32_t cp;
+			std::size_t length;
+			if (buffer.offset() >= buffer.utf8_offset() && buffer.has_next())
+				length = decode_valid_utf8(p, cp);
+			else
+				//! A sequence is at most four bytes, or ends at the end of the input.
+				length = decode_utf8(p, data.data() + data.size(), cp);
+			if (!length || !(m_any || m_set.contains(cp)))
+			{
+				buffer.examine(buffer.offset() + 4);
+				return maybe<char32_t>::nothing;
+			}
+
+			buffer.advance(length);
+			return maybe<char32_t>::just(cp);
+		}
+
+	private:
+		codepoint_set m_set;
+		std::string m_description;
+		bool m_any;
+	};
+
+	//! Mark the input from "o" on as valid UTF-8 for the lifetime of the guard, then put the mark back.
+	class utf8_guard
+	{
+	public:
+		utf8_guard(buffer<std::string>& b, std::size_t o)
+		: m_buffer(b), m_previous(b.utf8_offset())
+		{
+			m_buffer.set_utf8_offset(std::min(m_previous, o));
+		}
+
+		utf8_guard(const utf8_guard&) = delete;
+		~utf8_guard() { m_buffer.set_utf8_offset(m_previous); }
+
+	private:
+		buffer<std::string>& m_buffer;
+		std::size_t m_previous;
+	};
+
+	//! Check that the rest of the input is valid UTF-8, then run the inner parser.
+	/*! The whole remaining input is validated in one pass, so this belongs
+	 *  at the top of a grammar, not inside a loop. Invalid input fails
+	 *  without running the inner parser, and the buffer's context records
+	 *  the failure at the first invalid byte. While the inner parser runs,
+	 *  the buffer's "utf8_offset" tells code point parsers not to check
+	 *  the input again.
+	 */
+	template<typename R>
+	class utf8_parser : public parser<R, std::string>
+	{
+	private:
+		typedef typename parser_traits<parser<R, std::string>>::type_pointer subtype_pointer;
+
+	public:
+		utf8_parser(subtype_pointer p)
+		: parser<R, std::string>(), m_parser(p) {}
+
+		utf8_parser(const utf8_parser&) = default;
+		~utf8_parser() = default;
+
+		const char* kind() const { return "utf8"; }
+		std::string expected() const { return "valid UTF-8"; }
+		void children(std::vector<parser_node*>& c) const { c.push_back(m_parser.get()); }
+
+		maybe<R> apply(buffer<std::string>& buffer) const
+		{
+			if (!valid(buffer))
+				return maybe<R>::nothing;
+
+			utf8_guard checked(buffer, buffer.offset());
+			return m_parser->parse(buffer);
+		}
+
+		bool do_recognize(buffer<std::string>& buffer) const
+		{
+			if (!valid(buffer))
+				return false;
+
+			utf8_guard checked(buffer, buffer.offset());
+			return m_parser->recognize(buffer);
+		}
+
+	private:
+		bool valid(buffer<std::string>& buffer) const
+		{
+			auto& data = buffer.data();
+			const char* end = data.data() + data.size();
+			const char* bad = validate_utf8(data.data() + buffer.offset(), end);
+			buffer.examine(data.size() + 1);
+			if (bad == end)
+				return true;
+
+			if (buffer.context())
+				buffer.context()->failed(*this, bad - data.data());
+
+			return false;
+		}
+
+	private:
+		subtype_pointer m_parser;
+	};
+}
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "buffer.h"
+#include "context.h"
+#include "combinator.h"
+#include "detail/parser.h"
+
+namespace cpparse
+{
+	//! Why a parse failed: where it got to, and what would have let it continue.
+	struct parse_diagnostic
+	{
+		std::size_t offset;
+
+		//! Counted from 1. Only text input has lines; otherwise line is 1 and column is offset + 1.
+		std::size_t line, column;
+
+		//! Descriptions of what was expected, e.g. "\"let\"", "number", "end of input".
+		std::vector<std::string> expected;
+
+		//! The input at "offset", e.g. "'x'" or "end of input". Empty if it cannot be shown.
+		std::string found;
+
+		//! e.g. "line 3, column 7: expected ')' or number, found 'x'"
+		std::string message() const
+		{
+			std::string m = "line " + std::to_string(line) + ", column " + std::to_string(column) + ": ";
+			if (expected.empty())
+				m += "unexpected input";
+			else
+			{
+				m += "expected ";
+				for (std::size_t i = 0; i < expected.size(); ++i)
+					m += (i ? (i + 1 == expected.size() ? " or " : ", ") : "") + expected[i];
+			}
+
+			if (!found.empty())
+				m += ", found " + found;
+
+			return m;
+		}
+	};
+
+namespace detail
+{
+	//! Every parser reachable from "node", not counting "node" itself unless it recurses.
+	inline std::set<const parser_node*> descendants(const parser_node& node)
+	{
+		std::set<const parser_node*> found;
+
+		std::vector<parser_node*> pending;
+		node.children(pending);
+		while (!pending.empty())
+		{
+			auto inner = pending.back();
+			pending.pop_back();
+
+			if (found.insert(inner).second)
+				inner->children(pending);
+		}
+
+		return found;
+	}
+
+	//! Describe the parsers that failed at the farthest offset.
+	/*! A tagged parser is described by its tag, and stands for everything it
+	 *  contains, unless a tagged parser inside it failed there too (tags are
+	 *  also used for block values, so the innermost tag is the most
+	 *  specific). Untagged parsers that only combine others are left out,
+	 *  since what they contain has failed there too.
+	 */
+	inline std::vector<std::string> describe_failures(const std::vector<const parser_node*>& failures)
+	{
+		std::set<const parser_node*> covered, superseded;
+		for (auto node : failures)
+		{
+			if (node->tag().empty())
+				continue;
+
+			auto inside = descendants(*node);
+			for (auto other : failures)
+			{
+				if (other != node && inside.count(other) && !other->tag().empty())
+					superseded.insert(node);
+			}
+
+			covered.insert(inside.begin(), inside.end());
+		}
+
+		std::vector<std::string> described;
+		for (auto node : failures)
+		{
+			std::string text;
+			if (!node->tag().empty())
+			{
+				if (!superseded.count(node))
+					text = node->tag();
+			}
+			else if (!covered.count(node))
+				text = node->expected();
+
+			if (!text.empty() && std::find(described.begin(), described.end(), text) == described.end())
+				described.push_back(text);
+		}
+
+		return described;
+	}
+
+	template<typename C>
+	void locate(parse_diagnostic& d, const C&)
+	{
+		d.line = 1;
+		d.column = d.offset + 1;
+	}
+
+	inline void locate(parse_diagnostic& d, const std::string& input)
+	{
+		d.line = 1;
+		d.column = 1;
+		for (std::size_t i = 0; i < d.offset && i < input.size(); ++i)
+		{
+			if (input[i] == '\n')
+			{
+				d.line += 1;
+				d.column = 1;
+			}
+			else
+				d.column += 1;
+		}
+
+		if (d.offset < input.size())
+			d.found = quote(std::string(1, input[d.offset]), '\'');
+		else
+			d.found = "end of input";
+	}
+}
+
+	//! Explain the farthest failure "context" recorded while failing to parse "input".
+	template<typename C>
+	parse_diagnostic diagnose(const parse_context& context, const C& input)
+	{
+		parse_diagnostic d;
+		d.offset = context.farthest();
+		d.expected = detail::describe_failures(context.farthest_failures());
+
+		detail::locate(d, input);
+		return d;
+	}
+
+	//! Explain why a parse that succeeded stopped at "stopped", before the end of "input".
+	/*! The end of input was expected there, along with whatever failed at
+	 *  that offset, unless something got further.
+	 */
+	template<typename C>
+	parse_diagnostic diagnose(const parse_context& context, const C& input, std::size_t stopped)
+	{
+		if (!context.farthest_failures().empty() && context.farthest() > stopped)
+			return diagnose(context, input);
+
+		parse_diagnostic d;
+		d.offset = stopped;
+		if (!context.farthest_failures().empty() && context.farthest() == stopped)
+			d.expected = detail::describe_failures(context.farthest_failures());
+
+		d.expected.push_back("end of input");
+
+		detail::locate(d, input);
+		return d;
+	}
+
+	//! Parse the whole of "input", and explain the failure if that is not possible.
+	/*! Farthest failures are recorded as the parse goes, so an error costs no
+	 *  second parse. A failed "commit" is reported the same way. "context"
+	 *  supplies any limits; it is reset first.
+	 */
+	template<class P>
+	maybe<out_type<P>> parse_all(P p, const in_type<P>& input, parse_diagnostic& error, parse_context* context = nullptr)
+	{
+		parse_context local;
+		if (!context)
+			context = &local;
+
+		context->reset();
+
+		buffer<in_type<P>> buf(input, context);
+		maybe<out_type<P>> result;
+		try
+		{
+			result = p->parse(buf);
+		}
+		catch (const commit_failed&)
+		{
+			error = diagnose(*context, input);
+			return maybe<out_type<P>>::nothing;
+		}
+
+		if (result.is_just() && !buf.has_next())
+			return result;
+
+		error = result.is_just() ? diagnose(*context, input, buf.offset()) : diagnose(*context, input);
+		return maybe<out_type<P>>::nothing;
+	}
+}
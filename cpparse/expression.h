@@ -0,0 +1,32 @@
+#pragma once
+
+#include "parser.h"
+#include "detail/expression.h"
+#include "detail/parser_traits.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Expression Parser - operators over a primary, by precedence.
+	// ******************************************************************
+	typedef detail::associativity associativity;
+
+	template<typename R, typename T>
+	using operator_table = detail::operator_table<R, T>;
+
+	template<typename R, typename T>
+	using expression_parser = typename detail::parser_traits<detail::expression_parser<R, T>>::type_pointer;
+
+	/*! "primary" parses the operands, e.g. numbers and parenthesized
+	 *  expressions. The table gives the operators and how to fold them:
+	 *
+	 *      operator_table<long, std::string> ops;
+	 *      ops.infix(character('+'), 10, associativity::left, [](long a, long b) { return a + b; })
+	 *         .prefix(character('-'), 30, [](long a) { return -a; });
+	 */
+	template<class P>
+	expression_parser<out_type<P>, in_type<P>> expression(P primary, const operator_table<out_type<P>, in_type<P>>& table)
+	{
+		return make_parser<expression_parser<out_type<P>, in_type<P>>>(primary, table);
+	}
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "parser.h"
+#include "callbacks.h"
+#include "detail/image.h"
+#include "detail/save_parsers.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Grammar Images - save a grammar, and parse with it where it is mapped.
+	// ******************************************************************
+
+	//! Write "p" and everything it uses as a grammar image.
+	/*! The image is plain bytes with no addresses in it, so it can be
+	 *  written to a file and mapped back, in this or another process built
+	 *  the same way. "version" is the grammar's own version; loading checks
+	 *  it, so an image from an older grammar is not used by mistake.
+	 *
+	 *  Only text parsers can be saved. Lifts and blocks must be given their
+	 *  functions with "callback", and an option's alternate must be a
+	 *  character, string, number or empty value. Throws std::logic_error
+	 *  otherwise, e.g. for a "lexeme" or "expression" parser.
+	 */
+	template<class P>
+	std::string save_image(P p, std::uint32_t version)
+	{
+		detail::image_writer w;
+		auto root = w.node(p.get());
+
+		const detail::parser_node* node;
+		while (w.take(node))
+		{
+			if (!node->save(w))
+				throw std::logic_error(std::string("cpparse::save_image : Cannot save a \"") + node->kind() + "\" parser!");
+		}
+
+		return w.finish(root, version);
+	}
+
+	//! The functions lifts and blocks in an image call, by the names given to "callback".
+	/*! The library's own callbacks are already registered. Functions take
+	 *  their argument by const reference, as they do for lifts and blocks:
+	 *
+	 *      image_callbacks c;
+	 *      c.add("lisp::make_atom", &make_atom).add("lisp::inner", &inner);
+	 *
+	 *  Functors are added with "add_lift" or "add_block", giving the result
+	 *  and argument types, e.g. "c.add_lift<long, std::string>(name, f)".
+	 */
+	class image_callbacks
+	{
+	public:
+		image_callbacks()
+		{
+			typedef detail::image_value value;
+			typedef std::map<std::string, value> bound;
+
+			auto& ignore = m_callbacks["cpparse::callbacks::ignore"];
+			ignore.lift = [](const value&) { return value(); };
+			ignore.block = [](const bound&) { return value(); };
+
+			m_callbacks["cpparse::callbacks::char_string"].lift = [](const value& v) { return value::of_text(std::string(1, v.as_char())); };
+
+			m_callbacks["cpparse::callbacks::make_vector"].lift = [](const value& v)
+			{
+				auto l = value::of_list();
+				l.as_list().push_back(v);
+				return l;
+			};
+
+			m_callbacks["cpparse::callbacks::join_separated"].block = [](const bound& m)
+			{
+				auto& first = m.at("first");
+				if (first.kind() != value::list || first.as_list().empty())
+					throw std::logic_error("cpparse::grammar_image : A value is not of the type a callback expects!");
+
+				auto l = value::of_list();
+				l.as_list().push_back(first.as_list()[0]);
+				for (auto& e : m.at("rest").as_list())
+					l.as_list().push_back(e);
+
+				return l;
+			};
+		}
+
+		image_callbacks(const image_callbacks&) = default;
+		~image_callbacks() = default;
+
+		template<typename R, typename M>
+		image_callbacks& add(const std::string& name, R (*f)(const M&)) { return add_lift<R, M>(name, f); }
+
+		template<typename R, typename M>
+		image_callbacks& add(const std::string& name, R (*f)(const std::map<std::string, M>&)) { return add_block<R, M>(name, f); }
+
+		template<typename R, typename M, typename F>
+		image_callbacks& add_lift(const std::string& name, const F& f)
+		{
+			m_callbacks[name].lift = [f](const detail::image_value& v)
+			{
+				return detail::image_traits<R>::from(f(detail::image_traits<M>::to(v)));
+			};
+
+			return *this;
+		}
+
+		//! The results bound in the block are converted to a map of "M" for each call.
+		template<typename R, typename M, typename F>
+		image_callbacks& add_block(const std::string& name, const F& f)
+		{
+			m_callbacks[name].block = [f](const std::map<std::string, detail::image_value>& bound)
+			{
+				std::map<std::string, M> converted;
+				for (auto& b : bound)
+					converted.insert(converted.end(), std::make_pair(b.first, detail::image_traits<M>::to(b.second)));
+
+				return detail::image_traits<R>::from(f(converted));
+			};
+
+			return *this;
+		}
+
+		//! The functions registered as "name", or nullptr.
+		const detail::image_callback* find(const std::string& name) const
+		{
+			auto found = m_callbacks.find(name);
+			return (found == m_callbacks.end()) ? nullptr : &found->second;
+		}
+
+	private:
+		std::map<std::string, detail::image_callback> m_callbacks;
+	};
+
+	//! A grammar image, checked and ready to parse with.
+	/*! The image is read where it is, without rebuilding any parsers, so it
+	 *  must outlive this object, as must "callbacks". Loading checks the
+	 *  whole image once and looks up each callback by name, and throws
+	 *  std::runtime_error for a damaged image, another format or grammar
+	 *  version, or a callback that is not registered.
+	 *
+	 *  Like generated code, an image gives the same results as the grammar.
+	 *  Steps and the depth limit of the buffer's parse_context apply, but
+	 *  failures are not reported to it.
+	 *
+	 *      mapped_file file("lisp.image");
+	 *      grammar_image lisp(file.data(), file.size(), callbacks, 3);
+	 *      auto result = lisp.parse<token_pointer>(b);
+	 */
+	class grammar_image
+	{
+	public:
+		grammar_image(const void* data, std::size_t size, const image_callbacks& callbacks, std::uint32_t version)
+		: m_program(data, size, version, [&callbacks](const std::string& name) { return callbacks.find(name); }) {}
+
+		grammar_image(const grammar_image&) = default;
+		~grammar_image() = default;
+
+		//! Parse with the grammar's root. "R" must be the result type of the saved parser.
+		template<typename R>
+		maybe<R> parse(buffer<std::string>& b) const
+		{
+			detail::image_value result;
+			if (!m_program.parse(m_program.root(), b, result))
+				return maybe<R>::nothing;
+
+			return maybe<R>::just(detail::image_traits<R>::to(result));
+		}
+
+		//! Match like "parse", without building a result or calling any callback.
+		bool recognize(buffer<std::string>& b) const { return m_program.recognize(m_program.root(), b); }
+
+		std::size_t nodes() const { return m_program.nodes(); }
+
+	private:
+		detail::image_program m_program;
+	};
+
+	//! A file mapped read-only into memory, e.g. a grammar image.
+	/*! Uses mmap where there is one, so pages are only read when used and
+	 *  are shared between processes; elsewhere the file is read into memory.
+	 *  Throws std::runtime_error if the file cannot be opened.
+	 */
+	class mapped_file
+	{
+	public:
+		mapped_file(const std::string& path)
+		: m_data(nullptr), m_size(0)
+		{
+#if defined(__unix__) || defined(__APPLE__)
+			int fd = ::open(path.c_str(), O_RDONLY);
+			struct stat info;
+			if (fd < 0 || ::fstat(fd, &info) != 0)
+			{
+				if (fd >= 0)
+					::close(fd);
+
+				fail(path);
+			}
+
+			m_size = static_cast<std::size_t>(info.st_size);
+			if (m_size)
+			{
+				void* mapped = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapped == MAP_FAILED)
+				{
+					::close(fd);
+					fail(path);
+				}
+
+				m_data = mapped;
+			}
+
+			::close(fd);
+#else
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if (!file)
+				fail(path);
+
+			m_size = static_cast<std::size_t>(file.tellg());
+			m_copy.resize((m_size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(m_copy.data()), m_size);
+			m_data = m_copy.data();
+#endif
+		}
+
+		mapped_file(const mapped_file&) = delete;
+		~mapped_file()
+		{
+#if defined(__unix__) || defined(__APPLE__)
+			if (m_data)
+				::munmap(const_cast<void*>(m_data), m_size);
+#endif
+		}
+
+		const void* data() const { return m_data; }
+		std::size_t size() const { return m_size; }
+
+	private:
+		static void fail(const std::string& path)
+		{
+			throw std::runtime_error("cpparse::mapped_file : Cannot map \"" + path + "\"!");
+		}
+
+	private:
+		const void* m_data;
+		std::size_t m_size;
+#if !defined(__unix__) && !defined(__APPLE__)
+		//! Words, so the copy is aligned as a mapping would be.
+		std::vector<std::uint64_t> m_copy;
+#endif
+	};
+}
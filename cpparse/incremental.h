@@ -0,0 +1,122 @@
+#pragma once
+
+#include <iterator>
+#include <stdexcept>
+
+#include "maybe.h"
+#include "buffer.h"
+#include "parser.h"
+#include "context.h"
+#include "detail/memo.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Memo Parser - keep a parser's matches, to reuse them after an edit.
+	// ******************************************************************
+	template<typename R, typename T>
+	using memo_parser = typename detail::parser_traits<detail::memo_parser<R, T>>::type_pointer;
+
+	/*! Matches are kept in the memo table of the buffer's context, which an
+	 *  "incremental_document" provides; without one, the parser only passes
+	 *  the parse through. Wrap the parser for one item of a list (e.g. one
+	 *  expression), not the whole list, so an edit drops one item's match.
+	 *
+	 *  A match is reused while the input it looked at is unchanged, which
+	 *  the buffer tracks (see "buffer::examined").
+	 */
+	template<class P>
+	memo_parser<out_type<P>, in_type<P>> memo(P p)
+	{
+		return make_parser<memo_parser<out_type<P>, in_type<P>>>(p);
+	}
+
+	// ******************************************************************
+	//! Incremental Parsing - reparse an edited input, reusing what the edit did not touch.
+	// ******************************************************************
+
+	/*! Holds the input and the matches of the grammar's "memo" parsers. After
+	 *  an edit only the matches that looked at the edited input are dropped,
+	 *  so the next parse runs the grammar again only around the edit, and
+	 *  reuses the rest:
+	 *
+	 *      incremental_document<parser<token_pointer, std::string>> doc(grammar, text);
+	 *      doc.parse();
+	 *      doc.edit(120, 3, "(+ 1 2)");
+	 *      auto result = doc.parse();
+	 *
+	 *  Each reused match is still found and copied out, so a parse costs
+	 *  about one lookup per memoized item around the edit, plus the items of
+	 *  the lists that contain it. The grammar is frozen first.
+	 */
+	template<class P>
+	class incremental_document
+	{
+	public:
+		typedef in_type<P> container_type;
+		typedef out_type<P> result_type;
+
+	public:
+		incremental_document(P grammar, const container_type& input)
+		: m_grammar(grammar), m_input(input), m_memo(), m_context(), m_consumed(0)
+		{
+			freeze(m_grammar);
+			m_memo.reset(m_input.size());
+			m_context.set_memo(&m_memo);
+		}
+
+		//! The context points at this document's memo table, so it cannot be copied.
+		incremental_document(const incremental_document&) = delete;
+		~incremental_document() = default;
+
+		//! Parse the input as it is now.
+		/*! The context is reset first, keeping its limits. */
+		maybe<result_type> parse()
+		{
+			m_context.reset();
+			m_memo.reset_hits();
+
+			buffer<container_type> b(m_input, &m_context);
+			auto result = m_grammar->parse(b);
+			m_consumed = b.offset();
+			return result;
+		}
+
+		//! Replace the "removed" values at "offset" with "inserted".
+		/*! Throws std::out_of_range if the removed values are not all in the input. */
+		void edit(std::size_t offset, std::size_t removed, const container_type& inserted)
+		{
+			m_memo.edit(offset, removed, inserted.size());
+
+			auto at = std::next(m_input.begin(), offset);
+			at = m_input.erase(at, std::next(at, removed));
+			m_input.insert(at, inserted.begin(), inserted.end());
+		}
+
+		//! Replace the whole input, dropping every match.
+		void assign(const container_type& input)
+		{
+			m_input = input;
+			m_memo.reset(m_input.size());
+		}
+
+		const container_type& input() const { return m_input; }
+
+		//! How much of the input the last parse consumed.
+		std::size_t consumed() const { return m_consumed; }
+
+		//! How many matches the last parse reused, and how many are kept.
+		std::size_t reused() const { return m_memo.hits(); }
+		std::size_t memoized() const { return m_memo.size(); }
+
+		//! The context every parse uses, e.g. to set limits or read failures for "diagnose".
+		parse_context& context() { return m_context; }
+
+	private:
+		P m_grammar;
+		container_type m_input;
+		detail::memo_table m_memo;
+		parse_context m_context;
+		std::size_t m_consumed;
+	};
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "parser.h"
+#include "string_parser.h"
+#include "detail/trivia.h"
+#include "detail/parser_traits.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Lexeme Parser - a token followed by whitespace and comments.
+	// ******************************************************************
+	typedef detail::trivia_spec trivia;
+
+	template<typename R>
+	using lexeme_parser = typename detail::parser_traits<detail::lexeme_parser<R>>::type_pointer;
+	using trivia_parser = typename detail::parser_traits<detail::trivia_parser>::type_pointer;
+
+	//! Makes the tokens of one grammar, all skipping the same trivia.
+	/*! Configure it once, then wrap every token parser:
+	 *
+	 *      lexer lex(trivia().line_comment(";").block_comment("#|", "|#", true));
+	 *      auto open = lex(character('('));
+	 *
+	 *  Tokens skip the trivia after them, so only the start of the input
+	 *  needs "lex.skip()".
+	 */
+	class lexer
+	{
+	public:
+		lexer(const trivia& t = trivia())
+		: m_scanner(std::make_shared<const detail::trivia_scanner>(t)) {}
+
+		lexer(const lexer&) = default;
+		~lexer() = default;
+
+		template<class P>
+		lexeme_parser<out_type<P>> operator()(P p) const
+		{
+			static_assert(std::is_same<in_type<P>, std::string>::value, "cpparse::lexer : Tokens must parse strings!");
+			return make_parser<lexeme_parser<out_type<P>>>(p, m_scanner);
+		}
+
+		//! A token of fixed text, e.g. a keyword or punctuation.
+		lexeme_parser<std::string> symbol(const std::string& s) const { return (*this)(string(s)); }
+
+		//! Skip trivia without a token, e.g. at the start of the input.
+		trivia_parser skip() const { return make_parser<trivia_parser>(m_scanner); }
+
+	private:
+		std::shared_ptr<const detail::trivia_scanner> m_scanner;
+	};
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "parser.h"
+#include "detail/literal.h"
+#include "detail/parser_traits.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Literal Parser - text fixed at compile time.
+	// ******************************************************************
+	template<char... Cs>
+	using literal_parser = typename detail::parser_traits<detail::literal_parser<Cs...>>::type_pointer;
+
+	//! e.g. "lit<'l', 'e', 't'>()". Behaves like "string", but is compared without a loop.
+	template<char... Cs>
+	literal_parser<Cs...> lit()
+	{
+		return make_parser<literal_parser<Cs...>>();
+	}
+
+	// ******************************************************************
+	//! Literal Choice - "|" between literals, resolved at compile time.
+	// ******************************************************************
+	template<class... Ls>
+	using literal_choice_parser = typename detail::parser_traits<detail::literal_choice_parser<Ls...>>::type_pointer;
+
+	//! These overloads are chosen over the general "|", so a chain of literals becomes one parser.
+	/*! The result's type says everything about it, so tags set on the
+	 *  literals themselves are not kept; tag the choice instead.
+	 */
+	template<char... A, char... B>
+	literal_choice_parser<detail::literal_parser<A...>, detail::literal_parser<B...>> operator|(std::shared_ptr<detail::literal_parser<A...>>, std::shared_ptr<detail::literal_parser<B...>>)
+	{
+		return make_parser<literal_choice_parser<detail::literal_parser<A...>, detail::literal_parser<B...>>>();
+	}
+
+	template<class... Ls, char... B>
+	literal_choice_parser<Ls..., detail::literal_parser<B...>> operator|(std::shared_ptr<detail::literal_choice_parser<Ls...>>, std::shared_ptr<detail::literal_parser<B...>>)
+	{
+		return make_parser<literal_choice_parser<Ls..., detail::literal_parser<B...>>>();
+	}
+
+	template<char... A, class... Ls>
+	literal_choice_parser<detail::literal_parser<A...>, Ls...> operator|(std::shared_ptr<detail::literal_parser<A...>>, std::shared_ptr<detail::literal_choice_parser<Ls...>>)
+	{
+		return make_parser<literal_choice_parser<detail::literal_parser<A...>, Ls...>>();
+	}
+
+	template<class... Ls, class... Ms>
+	literal_choice_parser<Ls..., Ms...> operator|(std::shared_ptr<detail::literal_choice_parser<Ls...>>, std::shared_ptr<detail::literal_choice_parser<Ms...>>)
+	{
+		return make_parser<literal_choice_parser<Ls..., Ms...>>();
+	}
+
+namespace detail
+{
+	template<class L, std::size_t N>
+	std::shared_ptr<L> make_literal(const char (&)[N])
+	{
+		static_assert(N - 1 <= 32, "cpparse::CPPARSE_LIT : Literals are limited to 32 characters!");
+		return std::make_shared<L>();
+	}
+}
+
+	// ******************************************************************
+	//! Class Parser - a set of characters fixed at compile time.
+	// ******************************************************************
+	template<char... Bounds>
+	using class_parser = typename detail::parser_traits<detail::class_parser<Bounds...>>::type_pointer;
+
+	//! e.g. "cls<'a', 'z', 'A', 'Z', '_', '_'>()". Behaves like "one_of", with a table built at compile time.
+	template<char... Bounds>
+	class_parser<Bounds...> cls()
+	{
+		return make_parser<class_parser<Bounds...>>();
+	}
+}
+
+#define CPPARSE_LIT_AT(s, i) cpparse::detail::literal_at(s, i)
+#define CPPARSE_LIT_8(s, i) CPPARSE_LIT_AT(s, i), CPPARSE_LIT_AT(s, i + 1), CPPARSE_LIT_AT(s, i + 2), CPPARSE_LIT_AT(s, i + 3), \
+	CPPARSE_LIT_AT(s, i + 4), CPPARSE_LIT_AT(s, i + 5), CPPARSE_LIT_AT(s, i + 6), CPPARSE_LIT_AT(s, i + 7)
+
+//! A "lit" parser for a string literal of up to 32 characters, e.g. CPPARSE_LIT("define").
+#define CPPARSE_LIT(s) cpparse::detail::make_literal<typename cpparse::detail::literal_trim<cpparse::detail::literal_parser<>, \
+	CPPARSE_LIT_8(s, 0), CPPARSE_LIT_8(s, 8), CPPARSE_LIT_8(s, 16), CPPARSE_LIT_8(s, 24)>::type>(s)
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <new>
+#include <utility>
 #include <stdexcept>
+#include <type_traits>
 
 namespace cpparse
 {
@@ -14,22 +17,46 @@ namespace cpparse
 	public:
 		//! Should always be constructed with these static functions.
 		static maybe just(const value_type&);
+		static maybe just(value_type&&);
 		static const maybe nothing;
 
 	public:
 		maybe() : m_value(nullptr) {}
 		maybe(const value_type& v) 
-		: m_value(new (m_storage) value_type(v)) {}
+		: m_value(new (&m_storage) value_type(v)) {}
 		
-		maybe(const maybe& other) { *this = other; }
-		~maybe() = default;
+		//! Results are moved up through the parsers that return them, rather than copied.
+		maybe(value_type&& v)
+		: m_value(new (&m_storage) value_type(std::move(v))) {}
+
+		maybe(const maybe& other)
+		: m_value(nullptr) { *this = other; }
+
+		maybe(maybe&& other)
+		: m_value(nullptr) { *this = std::move(other); }
+
+		~maybe() { clear(); }
 
 		maybe& operator=(const maybe& other)
 		{
+			if (this == &other)
+				return *this;
+
+			clear();
+			if (other.m_value)
+				m_value = new (&m_storage) value_type(other.from_just());
+
+			return *this;
+		}
+
+		maybe& operator=(maybe&& other)
+		{
+			if (this == &other)
+				return *this;
+
+			clear();
 			if (other.m_value)
-				m_value = new (m_storage) value_type(other.from_just());
-			else
-				m_value = nullptr;
+				m_value = new (&m_storage) value_type(std::move(*other.m_value));
 
 			return *this;
 		}
@@ -58,13 +85,24 @@ namespace cpparse
 		operator bool() { return is_just(); }
 
 	private:
-		//! Use a char array so an empty T is never intialized.
-		char m_storage[sizeof(value_type)];
+		//! Destroy the contained value, if there is one.
+		void clear()
+		{
+			if (m_value)
+				m_value->~value_type();
+
+			m_value = nullptr;
+		}
+
+		//! Use raw storage so an empty T is never intialized.
+		typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type m_storage;
 		value_type* m_value;
 	};
 
 	template<typename T>
 	maybe<T> maybe<T>::just(const T& value) { return maybe<T>(value); }
 	template<typename T>
+	maybe<T> maybe<T>::just(T&& value) { return maybe<T>(std::move(value)); }
+	template<typename T>
 	const maybe<T> maybe<T>::nothing = maybe<T>();
 }
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+#include "parser.h"
+#include "detail/numeric.h"
+#include "detail/parser_traits.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Numeric Parsers - numbers converted straight from the input.
+	// ******************************************************************
+	template<typename T>
+	using integer_parser = typename detail::parser_traits<detail::integer_parser<T>>::type_pointer;
+	template<typename T>
+	using floating_parser = typename detail::parser_traits<detail::floating_parser<T>>::type_pointer;
+
+	//! A decimal integer with an optional sign, e.g. "-42". Fails if the value does not fit in T.
+	template<typename T = long>
+	integer_parser<T> integer()
+	{
+		return make_parser<integer_parser<T>>(true, false);
+	}
+
+	//! Decimal digits without a sign.
+	template<typename T = unsigned long>
+	integer_parser<T> unsigned_integer()
+	{
+		return make_parser<integer_parser<T>>(false, false);
+	}
+
+	//! Hexadecimal digits, with or without "0x".
+	template<typename T = unsigned long>
+	integer_parser<T> hexadecimal()
+	{
+		return make_parser<integer_parser<T>>(false, true);
+	}
+
+	//! A decimal number with an optional sign, point and exponent, e.g. "-1.5e3".
+	template<typename T = double>
+	floating_parser<T> floating()
+	{
+		return make_parser<floating_parser<T>>();
+	}
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "maybe.h"
+#include "buffer.h"
+#include "parser.h"
+#include "detail/parallel.h"
+#include "detail/sexpr_scanner.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Batch Parsing - apply one grammar to many inputs on several threads.
+	// ******************************************************************
+
+	/*! Results are returned in the same order as the inputs. "threads" set to
+	 *  0 uses one thread per core. The grammar is frozen first, so it cannot
+	 *  change while the workers share it.
+	 *
+	 *  Each input is parsed in a buffer of its own that is dropped afterwards,
+	 *  so a grammar returning a "byte_span" or "text_span" does not compile;
+	 *  copy the span in a lift instead. A lift that keeps a span inside its
+	 *  own result is not caught, and must not do so.
+	 */
+	template<class P>
+	std::vector<maybe<out_type<P>>> parse_batch(P grammar, const std::vector<in_type<P>>& inputs, std::size_t threads = 0)
+	{
+		static_assert(!detail::refers_to_input<out_type<P>>::value, "cpparse::parse_batch : The results would point into dropped buffers!");
+		freeze(grammar);
+
+		//! Workers share a plain reference, so no reference counts are touched while parsing.
+		const detail::parser<out_type<P>, in_type<P>>& p = *grammar;
+
+		std::vector<maybe<out_type<P>>> results(inputs.size());
+		detail::parallel_for(inputs.size(), threads,
+			[&](std::size_t i)
+			{
+				buffer<in_type<P>> buf(inputs[i]);
+				results[i] = p.parse(buf);
+			});
+
+		return results;
+	}
+
+	// ******************************************************************
+	//! Record Parsing - split one large input into records and parse them in parallel.
+	// ******************************************************************
+
+	//! What happened in one chunk of a "parse_records" call.
+	struct chunk_report
+	{
+		std::size_t offset;			//!< Where the chunk starts in the input.
+		std::size_t length;
+		std::size_t first_record;	//!< Index of the chunk's first record in the results.
+		std::size_t records;
+		std::vector<std::size_t> failures;	//!< Input offsets of records that did not parse.
+	};
+
+	template<typename R>
+	struct record_results
+	{
+		std::vector<maybe<R>> values;		//!< One entry per record, in input order.
+		std::vector<chunk_report> chunks;
+	};
+
+	/*! The input is cut into one record per "delimiter" (the delimiter is not
+	 *  part of the record, and empty records are skipped). A record only
+	 *  counts as parsed if the grammar consumes all of it.
+	 *
+	 *  The input is divided into a few chunks per thread, each ending on a
+	 *  record boundary, and the chunks are parsed in parallel. The grammar is
+	 *  frozen first. As for "parse_batch", each record has its own buffer, so
+	 *  the grammar cannot return spans.
+	 */
+	template<class P>
+	record_results<out_type<P>> parse_records(P grammar, const in_type<P>& input,
+		const typename buffer<in_type<P>>::value_type& delimiter, std::size_t threads = 0)
+	{
+		typedef typename in_type<P>::const_iterator iterator;
+
+		static_assert(!detail::refers_to_input<out_type<P>>::value, "cpparse::parse_records : The results would point into dropped buffers!");
+		freeze(grammar);
+		const detail::parser<out_type<P>, in_type<P>>& p = *grammar;
+
+		if (!threads)
+			threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+		//! A few chunks per thread, so a slow chunk can be balanced out by stealing.
+		std::size_t total = input.size();
+		std::size_t wanted = std::max<std::size_t>(1, std::min(total, threads * 4));
+
+		std::vector<iterator> bounds(1, input.begin());
+		for (std::size_t k = 1; k < wanted; ++k)
+		{
+			auto from = input.begin() + total * k / wanted;
+			if (from < bounds.back())
+				continue;
+
+			auto cut = std::find(from, input.end(), delimiter);
+			if (cut == input.end())
+				break;
+
+			bounds.push_back(cut + 1);
+		}
+		bounds.push_back(input.end());
+
+		std::size_t count = bounds.size() - 1;
+		std::vector<std::vector<maybe<out_type<P>>>> values(count);
+
+		record_results<out_type<P>> results;
+		results.chunks.resize(count);
+
+		detail::parallel_for(count, threads,
+			[&](std::size_t c)
+			{
+				chunk_report& report = results.chunks[c];
+				report.offset = bounds[c] - input.begin();
+				report.length = bounds[c + 1] - bounds[c];
+
+				auto start = bounds[c];
+				while (start != bounds[c + 1])
+				{
+					auto stop = std::find(start, bounds[c + 1], delimiter);
+					if (stop != start)
+					{
+						buffer<in_type<P>> buf(in_type<P>(start, stop));
+						auto result = p.parse(buf);
+						if (result.is_just() && buf.has_next())
+							result = maybe<out_type<P>>::nothing;
+
+						if (result.is_nothing())
+							report.failures.push_back(start - input.begin());
+
+						values[c].push_back(result);
+					}
+
+					start = (stop == bounds[c + 1]) ? stop : stop + 1;
+				}
+
+				report.records = values[c].size();
+			});
+
+		for (std::size_t c = 0; c < count; ++c)
+		{
+			results.chunks[c].first_record = results.values.size();
+			results.values.insert(results.values.end(), values[c].begin(), values[c].end());
+		}
+
+		return results;
+	}
+
+	// ******************************************************************
+	//! S-Expression Reader - parse one large nested document in parallel.
+	// ******************************************************************
+	using sexpr_syntax = detail::sexpr_syntax;
+
+	/*! The document must be a list of elements separated by spaces, matching a
+	 *  rule like ( '(' >> sep_by(element, spaces()) >> ')' ) whose result is
+	 *  built by "make_list", which takes a const std::vector<R>&.
+	 *
+	 *  The list is split into its elements by a parallel pre-scan (see
+	 *  "detail::sexpr_scanner"), without running the grammar. Elements that
+	 *  are themselves large lists are split again, down to a few levels, so the
+	 *  work divides evenly even when most of the document sits inside one
+	 *  deep element. The remaining pieces are parsed with "element" on all
+	 *  threads, then the tree is put back together with "make_list".
+	 *
+	 *  Any piece the scan cannot prove to be a plain list (e.g. an empty
+	 *  list) is left to "element" to parse, so the result is the same as
+	 *  parsing the whole document sequentially with the list rule.
+	 */
+	template<class P, typename F>
+	maybe<out_type<P>> parse_sexpr(P element, const std::string& input, const F& make_list,
+		std::size_t threads = 0, const sexpr_syntax& syntax = sexpr_syntax())
+	{
+		typedef out_type<P> result_type;
+		static_assert(!detail::refers_to_input<result_type>::value, "cpparse::parse_sexpr : The results would point into dropped buffers!");
+
+		struct piece
+		{
+			std::size_t begin, end, depth;
+			std::vector<std::size_t> children;
+		};
+
+		freeze(element);
+		const detail::parser<result_type, in_type<P>>& p = *element;
+
+		if (!threads)
+			threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+		//! Small pieces are not worth splitting, and very deep splitting repeats the scan too often.
+		const std::size_t grain = std::max<std::size_t>(4096, input.size() / (threads * 8));
+		const std::size_t max_depth = 16;
+
+		detail::sexpr_scanner scanner(syntax);
+		const char* text = input.data();
+
+		std::vector<piece> pieces(1, piece{0, input.size(), 0, {}});
+		std::vector<std::size_t> leaves;
+		for (std::size_t i = 0; i < pieces.size(); ++i)
+		{
+			std::vector<detail::sexpr_scanner::range> elements;
+			bool split = (pieces[i].end - pieces[i].begin > grain) && (pieces[i].depth < max_depth)
+				&& scanner.split(text + pieces[i].begin, text + pieces[i].end, threads, elements);
+
+			if (!split)
+			{
+				leaves.push_back(i);
+				continue;
+			}
+
+			for (auto& e : elements)
+			{
+				pieces[i].children.push_back(pieces.size());
+				pieces.push_back(piece{pieces[i].begin + e.first, pieces[i].begin + e.second, pieces[i].depth + 1, {}});
+			}
+		}
+
+		std::vector<maybe<result_type>> values(pieces.size());
+		std::atomic<bool> failed(false);
+		detail::parallel_for(leaves.size(), threads,
+			[&](std::size_t l)
+			{
+				if (failed)
+					return;
+
+				auto& leaf = pieces[leaves[l]];
+				buffer<std::string> buf(input.substr(leaf.begin, leaf.end - leaf.begin));
+
+				auto result = p.parse(buf);
+				if (result.is_nothing() || buf.has_next())
+					failed = true;
+				else
+					values[leaves[l]] = result;
+			});
+
+		if (failed)
+			return maybe<result_type>::nothing;
+
+		//! Children always come after their parent, so build from the back.
+		for (std::size_t i = pieces.size(); i-- > 0;)
+		{
+			if (pieces[i].children.empty())
+				continue;
+
+			std::vector<result_type> items;
+			for (auto c : pieces[i].children)
+				items.push_back(values[c].from_just());
+
+			values[i] = maybe<result_type>::just(make_list(items));
+		}
+
+		return values[0];
+	}
+}
@@ -37,7 +37,7 @@ namespace cpparse
 	//! Define a "tag" so some parsers can be referenced by name.
 	/*! This is mostly useful for the block parser, since it records results based on tag values. */
 	struct parser_tag { std::string string; };
-	parser_tag tag(const std::string& s) { return {s}; }
+	inline parser_tag tag(const std::string& s) { return {s}; }
 
 	template<class P>
 	P operator<<(const P& p, const parser_tag& t)
@@ -48,6 +48,18 @@ namespace cpparse
 		return tagged;
 	}
 
+	//! Make a grammar immutable, so it can be shared between threads.
+	/*! Every parser reachable from "p" is frozen. Afterwards, calls like
+	 *  "set_target" or "set_tag" on any of them throw std::logic_error. Also
+	 *  throws if the grammar still contains an unset placeholder.
+	 */
+	template<class P>
+	P freeze(P p)
+	{
+		p->freeze();
+		return p;
+	}
+
 	// ******************************************************************
 	//! Forward Parser - wraps another parser; good for recursion.
 	// ******************************************************************
@@ -78,6 +90,31 @@ namespace cpparse
 		return make_parser<skip_parser<in_type<P>, out_type<P>>>(p);
 	}
 
+	// ******************************************************************
+	//! Lookahead Parser - check the input that follows without consuming it.
+	// ******************************************************************
+	template<typename T, typename M, typename P>
+	using lookahead_parser = typename detail::parser_traits<detail::lookahead_parser<T, M, P>>::type_pointer;
+
+	template<class P>
+	using lookahead_of = lookahead_parser<in_type<P>, typename detail::lookahead_result<out_type<P>>::type, out_type<P>>;
+
+	//! Succeeds, consuming nothing, if "p" would match here.
+	/*! Like skip, an empty value is returned; an empty string for character parsers. */
+	template<class P>
+	lookahead_of<P> followed_by(P p)
+	{
+		return make_parser<lookahead_of<P>>(p, false);
+	}
+
+	//! Succeeds, consuming nothing, if "p" would not match here.
+	/*! e.g. "string("let") >>= not_followed_by(letter())" keeps "letter" from matching. */
+	template<class P>
+	lookahead_of<P> not_followed_by(P p)
+	{
+		return make_parser<lookahead_of<P>>(p, true);
+	}
+
 	// ******************************************************************
 	//! Option Parser - provide alternative output upon parser failure.
 	// ******************************************************************
@@ -96,6 +133,22 @@ namespace cpparse
 		return option(p, out_type<P>());
 	}
 
+	// ******************************************************************
+	//! Commit Parser - a parser that must succeed once reached.
+	// ******************************************************************
+	template<typename R, typename T>
+	using commit_parser = typename detail::parser_traits<detail::commit_parser<R, T>>::type_pointer;
+
+	/*! Use it after whatever settles which alternative the input is, e.g.
+	 *  "character('(') >> commit(keyword >> body)". A failure inside throws
+	 *  "commit_failed", ending the parse instead of backtracking.
+	 */
+	template<class P>
+	commit_parser<out_type<P>, in_type<P>> commit(P p)
+	{
+		return make_parser<commit_parser<out_type<P>, in_type<P>>>(p);
+	}
+
 	// ******************************************************************
 	//! Lift Parser - map the result of a parser to a new type.
 	// ******************************************************************
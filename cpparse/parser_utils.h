@@ -4,6 +4,7 @@
 
 #include "parser.h"
 #include "combinator.h"
+#include "callbacks.h"
 
 namespace cpparse
 {
@@ -11,14 +12,7 @@ namespace cpparse
 	template<class P>
 	lift_parser<std::vector<out_type<P>>, in_type<P>, out_type<P>> lift_vector(P p)
 	{
-		return lift<std::vector<out_type<P>>>(p,
-			[](const out_type<P>& r)
-			{
-				std::vector<out_type<P>> v;
-				v.push_back(r);
-
-				return v;
-			});
+		return lift<std::vector<out_type<P>>>(p, callback("cpparse::callbacks::make_vector", &callbacks::make_vector<out_type<P>>));
 	}
 
 	//! Parse a sequence of P parsers, whose input is separated by a parser S.
@@ -28,15 +22,7 @@ namespace cpparse
 		return block<std::vector<out_type<P>>, in_type<P>, std::vector<out_type<P>>>()
 			->* ( lift_vector(p) << tag("first") )
 			->* ( many(s >> p)   << tag("rest")  )
-			^ [](const std::map<std::string, std::vector<out_type<P>>>& m)
-			{
-				std::vector<out_type<P>> result;
-				result.push_back(m.at("first")[0]);
-				for (auto& e : m.at("rest"))
-					result.push_back(e);
-
-				return result;
-			};
+			^ callback("cpparse::callbacks::join_separated", &callbacks::join_separated<out_type<P>>);
 	}
 
 	//! Same as the sep_by combinator, but the separator S must be present after the last P.
@@ -47,14 +33,6 @@ namespace cpparse
 			->* ( lift_vector(p) << tag("first") )
 			->* ( many(s >> p)   << tag("rest")  )
 			->* ( s                              )
-			^ [](const std::map<std::string, std::vector<out_type<P>>>& m)
-			{
-				std::vector<out_type<P>> result;
-				result.push_back(m.at("first")[0]);
-				for (auto& e : m.at("rest"))
-					result.push_back(e);
-
-				return result;
-			};
+			^ callback("cpparse::callbacks::join_separated", &callbacks::join_separated<out_type<P>>);
 	}
 }
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "detail/probe.h"
+#include "detail/parser.h"
+
+namespace cpparse
+{
+	//! Values read from the hardware performance counters.
+	/*! A counter that could not be opened reads as -1. */
+	struct perf_sample
+	{
+		enum event { cycles, instructions, branch_misses, l1d_misses, llc_misses, event_count };
+
+		std::int64_t values[event_count];
+
+		perf_sample()
+		{
+			for (auto& v : values)
+				v = -1;
+		}
+
+		std::int64_t operator[](event e) const { return values[e]; }
+
+		//! The change between two samples. Unavailable counters stay at -1.
+		perf_sample operator-(const perf_sample& earlier) const
+		{
+			perf_sample d;
+			for (int e = 0; e < event_count; ++e)
+				if (values[e] >= 0 && earlier.values[e] >= 0)
+					d.values[e] = values[e] - earlier.values[e];
+
+			return d;
+		}
+
+		perf_sample& operator+=(const perf_sample& other)
+		{
+			for (int e = 0; e < event_count; ++e)
+				if (other.values[e] >= 0)
+					values[e] = (values[e] < 0 ? 0 : values[e]) + other.values[e];
+
+			return *this;
+		}
+
+		static const char* name(event e)
+		{
+			static const char* names[event_count] = { "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses" };
+			return names[e];
+		}
+	};
+
+	//! Count hardware events for the calling thread, using Linux "perf_event_open".
+	/*! Counting starts on construction. Counters the system does not allow
+	 *  (no permission, a virtual machine without a PMU, another OS) are simply
+	 *  unavailable, and read as -1, rather than being an error.
+	 */
+	class perf_counters
+	{
+	public:
+		perf_counters()
+		: m_leader(-1)
+		{
+			for (auto& fd : m_fds)
+				fd = -1;
+
+#if defined(__linux__)
+			const std::uint32_t types[perf_sample::event_count] = {
+				PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+			};
+			const std::uint64_t configs[perf_sample::event_count] = {
+				PERF_COUNT_HW_CPU_CYCLES,
+				PERF_COUNT_HW_INSTRUCTIONS,
+				PERF_COUNT_HW_BRANCH_MISSES,
+				PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+				PERF_COUNT_HW_CACHE_MISSES
+			};
+
+			//! All counters are read together with one call, through the first one that opens.
+			for (int e = 0; e < perf_sample::event_count; ++e)
+			{
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = types[e];
+				attr.config = configs[e];
+				attr.disabled = (m_leader < 0);
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP;
+
+				int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, m_leader, 0));
+				if (fd < 0)
+					continue;
+
+				m_fds[e] = fd;
+				m_order.push_back(e);
+				if (m_leader < 0)
+					m_leader = fd;
+			}
+
+			if (m_leader >= 0)
+				ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+		}
+
+		perf_counters(const perf_counters&) = delete;
+		~perf_counters()
+		{
+#if defined(__linux__)
+			for (auto fd : m_fds)
+				if (fd >= 0)
+					close(fd);
+#endif
+		}
+
+		bool available() const { return (m_leader >= 0); }
+		bool available(perf_sample::event e) const { return (m_fds[e] >= 0); }
+
+		//! The totals counted since construction.
+		perf_sample read() const
+		{
+			perf_sample sample;
+#if defined(__linux__)
+			if (m_leader < 0)
+				return sample;
+
+			std::uint64_t data[1 + perf_sample::event_count];
+			auto size = ::read(m_leader, data, sizeof(data));
+			if (size < static_cast<ssize_t>(sizeof(std::uint64_t)) || data[0] != m_order.size())
+				return sample;
+
+			for (std::size_t i = 0; i < m_order.size(); ++i)
+				sample.values[m_order[i]] = static_cast<std::int64_t>(data[1 + i]);
+#endif
+			return sample;
+		}
+
+	private:
+		int m_fds[perf_sample::event_count];
+		int m_leader;
+		std::vector<int> m_order;
+	};
+
+	//! Charge hardware events to each tagged parser on this thread.
+	/*! Like "profiler", this needs cpparse compiled with CPPARSE_PROFILE. The
+	 *  counters are read as every tagged parser starts and finishes (a system
+	 *  call each time), so untagged parsers cost nothing extra. A region
+	 *  includes the parsers it calls, and is counted once when it recurses
+	 *  into itself.
+	 */
+	class region_counters : public detail::parse_probe
+	{
+	public:
+		region_counters(const perf_counters& c)
+		: m_counters(c)
+		{
+			detail::attach_probe(this);
+		}
+
+		region_counters(const region_counters&) = delete;
+		~region_counters() { detail::detach_probe(this); }
+
+		//! Totals for each tag.
+		const std::map<std::string, perf_sample>& regions() const { return m_totals; }
+
+		void clear()
+		{
+			m_totals.clear();
+			m_open.clear();
+		}
+
+		void enter(const detail::parser_node& node, std::size_t)
+		{
+			if (node.tag().empty())
+				return;
+
+			auto& open = m_open[node.tag()];
+			if (!open.active++)
+				open.start = m_counters.read();
+		}
+
+		void leave(const detail::parser_node& node, std::size_t, bool)
+		{
+			if (node.tag().empty())
+				return;
+
+			auto& open = m_open[node.tag()];
+			if (!--open.active)
+				m_totals[node.tag()] += m_counters.read() - open.start;
+		}
+
+	private:
+		struct region
+		{
+			std::size_t active;
+			perf_sample start;
+
+			region()
+			: active(0), start() {}
+		};
+
+		const perf_counters& m_counters;
+		std::map<std::string, region> m_open;
+		std::map<std::string, perf_sample> m_totals;
+	};
+}
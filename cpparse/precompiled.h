@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "maybe.h"
+#include "buffer.h"
+#include "accumulator.h"
+#include "combinator.h"
+#include "numeric.h"
+
+// ******************************************************************
+//! Precompiled Parsers - use the cpparse library's copies of common parsers.
+// ******************************************************************
+
+/*! With CPPARSE_PRECOMPILED defined, as it is for everything linked with
+ *  the "cpparse" CMake target, the parsers listed in
+ *  "detail/instantiations.h" are declared "extern template". Translation
+ *  units then call the copies compiled into the library, instead of each
+ *  compiling every member (including virtual ones) of every parser again.
+ *
+ *  Instrumentation (CPPARSE_PROFILE, CPPARSE_TRACE, ...) changes what the
+ *  parsers compile to, so the declarations are left out when it is on.
+ *  The library must then be built in the same modes, with the CMake
+ *  variable CPPARSE_INSTRUMENTATION, or the two sets of parsers would
+ *  differ under the same names; CPPARSE_LIBRARY_PROBES, which the target
+ *  defines, catches a user that turns a mode on by itself.
+ */
+#if !defined(CPPARSE_PRECOMPILED)
+#define CPPARSE_PRECOMPILED 0
+#endif
+
+#if defined(CPPARSE_LIBRARY_PROBES) && CPPARSE_LIBRARY_PROBES != CPPARSE_PROBES
+#error "cpparse : The cpparse library was built in other instrumentation modes; set CPPARSE_INSTRUMENTATION instead!"
+#endif
+
+#if CPPARSE_PRECOMPILED && !CPPARSE_PROBES
+#define CPPARSE_INSTANTIATE(...) extern template class __VA_ARGS__;
+#include "detail/instantiations.h"
+#undef CPPARSE_INSTANTIATE
+#endif
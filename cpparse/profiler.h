@@ -0,0 +1,219 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <unordered_map>
+
+#include "detail/probe.h"
+#include "detail/parser.h"
+
+namespace cpparse
+{
+	//! Collect statistics for every parser used on this thread.
+	/*! Only records anything when cpparse is compiled with CPPARSE_PROFILE
+	 *  defined. Otherwise the parsers contain no profiling code at all, and
+	 *  the report is empty.
+	 *
+	 *  Statistics are kept from construction until destruction (or "clear").
+	 */
+	class profiler : public detail::parse_probe
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		//! Statistics for one parser.
+		/*! "total" includes the time spent in the parsers it calls (counted
+		 *  once, even if the parser recurses into itself), "self" does not.
+		 */
+		struct entry
+		{
+			std::string name;
+			std::size_t calls, successes, failures;
+			std::size_t consumed, rewound;
+			clock::duration total, self;
+		};
+
+	public:
+		profiler()
+		{
+			clear();
+			detail::attach_probe(this);
+		}
+
+		profiler(const profiler&) = delete;
+		~profiler() { detail::detach_probe(this); }
+
+		void clear()
+		{
+			m_entries.clear();
+			m_stack.clear();
+			m_paths.assign(1, path());
+		}
+
+		//! Every parser seen so far, with the most time spent first.
+		std::vector<entry> entries() const
+		{
+			std::vector<entry> sorted;
+			for (auto& e : m_entries)
+				sorted.push_back(e.second.stats);
+
+			std::sort(sorted.begin(), sorted.end(),
+				[](const entry& a, const entry& b) { return a.self > b.self; });
+
+			return sorted;
+		}
+
+		//! Write a table of the entries, with times in microseconds.
+		void report(std::ostream& out) const
+		{
+			out << std::left << std::setw(40) << "parser" << std::right
+				<< std::setw(10) << "calls" << std::setw(10) << "success" << std::setw(10) << "failure"
+				<< std::setw(12) << "consumed" << std::setw(12) << "rewound"
+				<< std::setw(12) << "total us" << std::setw(12) << "self us" << "\n";
+
+			for (auto& e : entries())
+			{
+				out << std::left << std::setw(40) << e.name << std::right
+					<< std::setw(10) << e.calls << std::setw(10) << e.successes << std::setw(10) << e.failures
+					<< std::setw(12) << e.consumed << std::setw(12) << e.rewound
+					<< std::setw(12) << microseconds(e.total) << std::setw(12) << microseconds(e.self) << "\n";
+			}
+		}
+
+		//! Write self time per call stack, in nanoseconds, in the "collapsed" format used by flamegraph tools.
+		/*! Each line is "frame;frame;frame count", with parsers named by tag or kind. */
+		void collapsed(std::ostream& out) const
+		{
+			for (std::size_t i = 1; i < m_paths.size(); ++i)
+			{
+				auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(m_paths[i].self).count();
+				if (!ns)
+					continue;
+
+				std::vector<std::size_t> frames;
+				for (auto p = i; p; p = m_paths[p].parent)
+					frames.push_back(p);
+
+				for (auto f = frames.rbegin(); f != frames.rend(); ++f)
+				{
+					auto& node = *m_paths[*f].node;
+					out << (f == frames.rbegin() ? "" : ";") << (node.tag().empty() ? node.kind() : node.tag());
+				}
+
+				out << " " << ns << "\n";
+			}
+		}
+
+		void enter(const detail::parser_node& node, std::size_t offset)
+		{
+			auto& found = m_entries[&node];
+			if (!found.stats.calls)
+				found.stats.name = name(node);
+
+			found.stats.calls += 1;
+			found.active += 1;
+
+			auto parent = m_stack.empty() ? 0 : m_stack.back().path;
+			auto known = m_paths[parent].children.find(&node);
+
+			std::size_t child = m_paths.size();
+			if (known != m_paths[parent].children.end())
+				child = known->second;
+			else
+			{
+				m_paths[parent].children[&node] = child;
+				m_paths.push_back(path(&node, parent));
+			}
+
+			m_stack.push_back(frame{ &found, offset, child, clock::now(), clock::duration::zero() });
+		}
+
+		void leave(const detail::parser_node&, std::size_t offset, bool success)
+		{
+			auto now = clock::now();
+
+			frame f = m_stack.back();
+			m_stack.pop_back();
+
+			auto total = now - f.start;
+			auto self = total - f.children;
+
+			auto& e = *f.owner;
+			e.active -= 1;
+			e.stats.self += self;
+			if (!e.active)
+				e.stats.total += total;
+
+			if (success)
+			{
+				e.stats.successes += 1;
+				e.stats.consumed += offset - f.offset;
+			}
+			else
+				e.stats.failures += 1;
+
+			m_paths[f.path].self += self;
+			if (!m_stack.empty())
+				m_stack.back().children += total;
+		}
+
+		//! Rewinds are charged to the parser that moved the buffer back.
+		void rewind(std::size_t from, std::size_t to)
+		{
+			if (!m_stack.empty() && from > to)
+				m_stack.back().owner->stats.rewound += from - to;
+		}
+
+	private:
+		struct record
+		{
+			entry stats;
+			std::size_t active;
+
+			record()
+			: stats{ "", 0, 0, 0, 0, 0, clock::duration::zero(), clock::duration::zero() }, active(0) {}
+		};
+
+		//! One distinct call stack, as a node in a tree of call stacks.
+		struct path
+		{
+			const detail::parser_node* node;
+			std::size_t parent;
+			std::map<const detail::parser_node*, std::size_t> children;
+			clock::duration self;
+
+			path(const detail::parser_node* n = nullptr, std::size_t p = 0)
+			: node(n), parent(p), children(), self(clock::duration::zero()) {}
+		};
+
+		struct frame
+		{
+			record* owner;
+			std::size_t offset;
+			std::size_t path;
+			clock::time_point start;
+			clock::duration children;
+		};
+
+		//! Untagged parsers are named by where they were first called from.
+		std::string name(const detail::parser_node& node) const
+		{
+			return detail::probe_name(node.tag(), node.kind(), m_stack.empty() ? nullptr : &m_stack.back().owner->stats.name);
+		}
+
+		static long long microseconds(const clock::duration& d)
+		{
+			return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+		}
+
+	private:
+		std::unordered_map<const detail::parser_node*, record> m_entries;
+		std::vector<frame> m_stack;
+		std::vector<path> m_paths;
+	};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+
+#include "parser.h"
+#include "detail/dfa.h"
+#include "detail/regular.h"
+#include "detail/regular_parsers.h"
+#include "detail/parser_traits.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Regular Parsers - subgrammars compiled to automata.
+	// ******************************************************************
+	using dfa_parser = typename detail::parser_traits<detail::dfa_parser>::type_pointer;
+	using dfa_span_parser = typename detail::parser_traits<detail::dfa_span_parser>::type_pointer;
+
+	//! True if "p" is made only of parsers that can be compiled by "compile_regular".
+	template<class P>
+	bool is_regular(P p)
+	{
+		detail::regular_expression r;
+		return p->regular(r) >= 0;
+	}
+
+	//! Compile a regular subgrammar to one table-driven automaton.
+	/*! "p" may contain characters, strings, one_of, none_of, lift_string,
+	 *  "|", ">>", ">>=" and "many". The result matches the longest prefix
+	 *  of the input in the language of "p", and returns all the text it
+	 *  matched. If "p" is not regular, or would need more than "max_states"
+	 *  states, it is returned as it is.
+	 */
+	template<class P>
+	parser<std::string, std::string> compile_regular(P p, std::size_t max_states = 4096)
+	{
+		static_assert(std::is_same<in_type<P>, std::string>::value && std::is_same<out_type<P>, std::string>::value, "cpparse::compile_regular : The parser must parse strings to strings!");
+
+		detail::regular_expression r;
+		int root = p->regular(r);
+
+		detail::dfa d;
+		if (root < 0 || !d.build(r, root, std::min<std::size_t>(max_states, 65535)))
+			return p;
+
+		std::string description = !p->tag().empty() ? p->tag() : p->expected();
+		return make_parser<dfa_parser>(d, description.empty() ? std::string("token") : description);
+	}
+
+	//! Like "compile_regular", but the automaton returns a "text_span" of the text it matched instead of a copy.
+	/*! Hand it to a "lift" whose function takes the span, so a token costs
+	 *  no allocation until the function makes one. Throws std::logic_error
+	 *  if "p" is not regular or needs too many states, as the parser could
+	 *  not return spans then.
+	 */
+	template<class P>
+	parser<text_span, std::string> compile_regular_span(P p, std::size_t max_states = 4096)
+	{
+		auto compiled = std::dynamic_pointer_cast<detail::dfa_parser>(compile_regular(p, max_states));
+		if (!compiled)
+			throw std::logic_error("cpparse::compile_regular_span : The parser is not regular, or needs too many states!");
+
+		return make_parser<dfa_span_parser>(compiled->automaton(), compiled->expected());
+	}
+}
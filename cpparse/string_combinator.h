@@ -16,15 +16,15 @@ namespace cpparse
 
 	using many_char_combinator = many_combinator<char, std::string>;
 
-	//! These overrides only work because the base "many" function requires an explicit template argument.
-	many_char_combinator many(parser<char, std::string> p, std::size_t min = 0, std::size_t max = 0)
+	//! These overrides are chosen over the templates for a plain parser<char, std::string>, so they cannot call them.
+	inline many_char_combinator many(parser<char, std::string> p, std::size_t min = 0, std::size_t max = 0)
 	{
-		return many(p, min, max);
+		return make_parser<many_char_combinator>(p, min, max);
 	}
 
-	many_char_combinator many1(parser<char, std::string> p, std::size_t max = 0)
+	inline many_char_combinator many1(parser<char, std::string> p, std::size_t max = 0)
 	{
-		return many1(p, max);
+		return make_parser<many_char_combinator>(p, 1, max);
 	}
 
 	// ******************************************************************
@@ -34,8 +34,8 @@ namespace cpparse
 	using merge_string_combinator = merge_combinator<std::string, std::string>;
 
 	//! The workaround for the "many" specializations applies here as well.
-	merge_string_combinator operator>>=(parser<std::string, std::string> a, parser<std::string, std::string> b)
+	inline merge_string_combinator operator>>=(parser<std::string, std::string> a, parser<std::string, std::string> b)
 	{
-		return operator>>=(a, b);
+		return make_parser<merge_string_combinator>(a, b);
 	}
 }
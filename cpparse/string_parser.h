@@ -13,7 +13,7 @@ namespace cpparse
 	// ******************************************************************
 	using char_parser = typename detail::parser_traits<detail::char_parser>::type_pointer;
 
-	char_parser character(char c)
+	inline char_parser character(char c)
 	{
 		return make_parser<char_parser>(c);
 	}
@@ -23,13 +23,13 @@ namespace cpparse
 	// ******************************************************************
 
 	using oneof_char_parser = oneof_parser<char, std::string>;
-	oneof_char_parser one_of(const std::string& s)
+	inline oneof_char_parser one_of(const std::string& s)
 	{
 		return one_of<std::string>(std::vector<char>(s.begin(), s.end()));
 	}
 
 	using noneof_char_parser = noneof_parser<char, std::string>;
-	noneof_char_parser none_of(const std::string& s)
+	inline noneof_char_parser none_of(const std::string& s)
 	{
 		return none_of<std::string>(std::vector<char>(s.begin(), s.end()));
 	}
@@ -39,7 +39,7 @@ namespace cpparse
 	// ******************************************************************
 	using string_parser = typename detail::parser_traits<detail::string_parser>::type_pointer;
 
-	string_parser string(const std::string& s)
+	inline string_parser string(const std::string& s)
 	{
 		return make_parser<string_parser>(s);
 	}
@@ -6,23 +6,19 @@
 namespace cpparse
 {
 	//! Common character parsers.
-	oneof_char_parser upper() { return one_of("ABCDEFGHIJKLMNOPQRSTUVWXYZ"); }
-	oneof_char_parser lower() { return one_of("abcdefghijklmnopqrstuvwxyz"); }
-	choice_combinator<char, std::string> letter() { return upper() | lower(); }
+	inline oneof_char_parser upper() { return one_of("ABCDEFGHIJKLMNOPQRSTUVWXYZ"); }
+	inline oneof_char_parser lower() { return one_of("abcdefghijklmnopqrstuvwxyz"); }
+	inline choice_combinator<char, std::string> letter() { return upper() | lower(); }
 
-	oneof_char_parser digit() { return one_of("1234567890"); }
-	oneof_char_parser symbol() { return one_of("!#$%&|*+-/:<=>?@^_~"); }
+	inline oneof_char_parser digit() { return one_of("1234567890"); }
+	inline oneof_char_parser symbol() { return one_of("!#$%&|*+-/:<=>?@^_~"); }
 
 	//! Retrieve all whitespace between tokens.
-	many_char_combinator spaces() { return many1(one_of(" \t\r\n")); }
+	inline many_char_combinator spaces() { return many1(one_of(" \t\r\n")); }
 
 	//! Convert a character parser to a string parser.
-	lift_parser<std::string, std::string, char> lift_string(parser<char, std::string> p)
+	inline lift_parser<std::string, std::string, char> lift_string(parser<char, std::string> p)
 	{
-		return lift<std::string>(p,
-			[](char c)
-			{
-				return std::string(1, c);
-			});
+		return make_parser<std::shared_ptr<detail::char_string_parser>>(p);
 	}
 }
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <unordered_map>
+
+#include "detail/probe.h"
+#include "detail/parser.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Trace Format
+	// ******************************************************************
+
+	//! One fixed-size record of a binary trace.
+	/*! A trace file is "trace_header" followed by records, in the byte order
+	 *  of the machine that wrote it. "word" holds the node id and the record
+	 *  kind. For "enter", "succeed" and "fail", "aux" is the call depth and
+	 *  "offset" the buffer position. For "rewind", "offset" is where the
+	 *  buffer moved back from and "aux" how far it went (at most 2^32-1).
+	 *
+	 *  A "name" record gives a node id its name: "aux" is the length of the
+	 *  name, whose bytes follow in as many records as they need. Names appear
+	 *  before the first event of their node.
+	 */
+	struct trace_event
+	{
+		enum kind_type { enter, succeed, fail, rewind, name };
+
+		std::uint32_t word;
+		std::uint32_t aux;
+		std::uint64_t offset;
+
+		static trace_event make(kind_type k, std::uint32_t node, std::uint32_t aux, std::uint64_t offset)
+		{
+			trace_event e = { (node << 3) | k, aux, offset };
+			return e;
+		}
+
+		kind_type kind() const { return static_cast<kind_type>(word & 7); }
+		std::uint32_t node() const { return word >> 3; }
+
+		//! The number of records that hold "length" bytes of name.
+		static std::size_t records_for(std::size_t length) { return (length + sizeof(trace_event) - 1) / sizeof(trace_event); }
+	};
+
+	struct trace_header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byte_order;
+
+		static trace_header current()
+		{
+			trace_header h;
+			std::memcpy(h.magic, "CPPTRACE", 8);
+			h.version = 1;
+			h.byte_order = 0x01020304;
+			return h;
+		}
+
+		bool valid() const
+		{
+			auto c = current();
+			return !std::memcmp(magic, c.magic, 8) && version == c.version && byte_order == c.byte_order;
+		}
+	};
+
+	// ******************************************************************
+	//! Tracer
+	// ******************************************************************
+
+	//! Record every parser call on this thread as a binary trace.
+	/*! Needs cpparse compiled with CPPARSE_TRACE (or another instrumentation
+	 *  mode); otherwise nothing is recorded.
+	 *
+	 *  A tracer either streams to an output stream, writing "buffer_events"
+	 *  records at a time, or keeps only the most recent "ring_events" records
+	 *  in memory, to be written with "save" when something went wrong. Either
+	 *  way an event is a 16 byte store, plus a hash lookup when a parser is
+	 *  entered. Replay a trace with tools/trace_replay.cpp.
+	 */
+	class tracer : public detail::parse_probe
+	{
+	public:
+		//! Keep the last "ring_events" events in memory.
+		explicit tracer(std::size_t ring_events)
+		: m_out(nullptr), m_events(ring_events ? ring_events : 1), m_next(0), m_recorded(0)
+		{
+			detail::attach_probe(this);
+		}
+
+		//! Stream every event to "out".
+		tracer(std::ostream& out, std::size_t buffer_events = 4096)
+		: m_out(&out), m_events(buffer_events ? buffer_events : 1), m_next(0), m_recorded(0)
+		{
+			write_header(out);
+			detail::attach_probe(this);
+		}
+
+		tracer(const tracer&) = delete;
+		~tracer()
+		{
+			detail::detach_probe(this);
+			flush();
+		}
+
+		//! The number of events recorded, including any a ring has dropped.
+		std::uint64_t recorded() const { return m_recorded; }
+
+		//! Write buffered events to the stream. Does nothing for a ring.
+		void flush()
+		{
+			if (!m_out || !m_next)
+				return;
+
+			m_out->write(reinterpret_cast<const char*>(m_events.data()), m_next * sizeof(trace_event));
+			m_out->flush();
+			m_next = 0;
+		}
+
+		//! Write the ring as a complete trace: every name, then the events, oldest first. Does nothing for a stream.
+		void save(std::ostream& out) const
+		{
+			if (m_out)
+				return;
+
+			write_header(out);
+			for (std::uint32_t id = 0; id < m_names.size(); ++id)
+			{
+				std::vector<trace_event> records;
+				name_records(id, records);
+				out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(trace_event));
+			}
+
+			auto size = m_events.size();
+			auto first = (m_recorded > size) ? m_next : 0;
+			auto count = (m_recorded > size) ? size : m_next;
+			for (std::size_t i = 0; i < count; ++i)
+				out.write(reinterpret_cast<const char*>(&m_events[(first + i) % size]), sizeof(trace_event));
+		}
+
+		void enter(const detail::parser_node& node, std::size_t offset)
+		{
+			auto found = m_ids.find(&node);
+			std::uint32_t id;
+			if (found != m_ids.end())
+				id = found->second;
+			else
+				id = add_node(node);
+
+			push(trace_event::make(trace_event::enter, id, static_cast<std::uint32_t>(m_stack.size()), offset));
+			m_stack.push_back(id);
+		}
+
+		void leave(const detail::parser_node&, std::size_t offset, bool success)
+		{
+			auto id = m_stack.back();
+			m_stack.pop_back();
+			push(trace_event::make(success ? trace_event::succeed : trace_event::fail, id, static_cast<std::uint32_t>(m_stack.size()), offset));
+		}
+
+		void rewind(std::size_t from, std::size_t to)
+		{
+			if (m_stack.empty() || from <= to)
+				return;
+
+			auto distance = from - to;
+			if (distance > 0xffffffffu)
+				distance = 0xffffffffu;
+
+			push(trace_event::make(trace_event::rewind, m_stack.back(), static_cast<std::uint32_t>(distance), from));
+		}
+
+	private:
+		static void write_header(std::ostream& out)
+		{
+			auto h = trace_header::current();
+			out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		}
+
+		void push(const trace_event& e)
+		{
+			m_recorded += 1;
+			m_events[m_next++] = e;
+
+			if (m_next == m_events.size())
+			{
+				if (m_out)
+					flush();
+				else
+					m_next = 0;
+			}
+		}
+
+		std::uint32_t add_node(const detail::parser_node& node)
+		{
+			auto id = static_cast<std::uint32_t>(m_names.size());
+			m_ids[&node] = id;
+			m_names.push_back(detail::probe_name(node.tag(), node.kind(), m_stack.empty() ? nullptr : &m_names[m_stack.back()]));
+
+			//! Streams carry names inline; a ring keeps them aside, so they are never overwritten.
+			if (m_out)
+			{
+				std::vector<trace_event> records;
+				name_records(id, records);
+				for (auto& r : records)
+					push(r);
+
+				m_recorded -= records.size();
+			}
+
+			return id;
+		}
+
+		void name_records(std::uint32_t id, std::vector<trace_event>& records) const
+		{
+			auto& name = m_names[id];
+			records.assign(1 + trace_event::records_for(name.size()), trace_event());
+			records[0] = trace_event::make(trace_event::name, id, static_cast<std::uint32_t>(name.size()), 0);
+			if (!name.empty())
+				std::memcpy(&records[1], name.data(), name.size());
+		}
+
+	private:
+		std::ostream* m_out;
+
+		std::vector<trace_event> m_events;
+		std::size_t m_next;
+		std::uint64_t m_recorded;
+
+		std::unordered_map<const detail::parser_node*, std::uint32_t> m_ids;
+		std::vector<std::string> m_names;
+		std::vector<std::uint32_t> m_stack;
+	};
+}
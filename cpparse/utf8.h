@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include "parser.h"
+#include "detail/utf8.h"
+#include "detail/parser_traits.h"
+
+namespace cpparse
+{
+	// ******************************************************************
+	//! Unicode Parsers - code points decoded from UTF-8 text.
+	// ******************************************************************
+	typedef detail::codepoint_set unicode_class;
+
+	using codepoint_parser = typename detail::parser_traits<detail::codepoint_parser>::type_pointer;
+
+	//! Any code point.
+	inline codepoint_parser codepoint()
+	{
+		return make_parser<codepoint_parser>(unicode_class(), "character", true);
+	}
+
+	//! A code point in "c", e.g. "unicode_class::letter() | unicode_class::of(\"_\")".
+	inline codepoint_parser codepoint(const unicode_class& c, const std::string& description = "character")
+	{
+		return make_parser<codepoint_parser>(c, description);
+	}
+
+	inline codepoint_parser unicode_letter() { return codepoint(unicode_class::letter(), "letter"); }
+	inline codepoint_parser unicode_digit() { return codepoint(unicode_class::digit(), "digit"); }
+	inline codepoint_parser unicode_space() { return codepoint(unicode_class::space(), "whitespace"); }
+
+	// ******************************************************************
+	//! UTF-8 Parser - validate the input once, before parsing it.
+	// ******************************************************************
+	template<typename R>
+	using utf8_parser = typename detail::parser_traits<detail::utf8_parser<R>>::type_pointer;
+
+	template<class P>
+	utf8_parser<out_type<P>> utf8(P p)
+	{
+		static_assert(std::is_same<in_type<P>, std::string>::value, "cpparse::utf8 : The parser must parse strings!");
+		return make_parser<utf8_parser<out_type<P>>>(p);
+	}
+
+	//! Encode code points, e.g. the result of "many(unicode_letter())", as UTF-8.
+	inline std::string to_utf8(char32_t cp)
+	{
+		std::string s;
+		detail::encode_utf8(cp, s);
+		return s;
+	}
+
+	inline std::string to_utf8(const std::vector<char32_t>& cps)
+	{
+		std::string s;
+		for (auto cp : cps)
+			detail::encode_utf8(cp, s);
+		return s;
+	}
+}
@@ -0,0 +1,9 @@
+#include "../cpparse/cpparse.h"
+
+//! The definitions for the "extern template" declarations of "precompiled.h".
+/*! Built into the "cpparse" library, so the parsers are compiled once. */
+#if !CPPARSE_PROBES
+#define CPPARSE_INSTANTIATE(...) template class __VA_ARGS__;
+#include "../cpparse/detail/instantiations.h"
+#undef CPPARSE_INSTANTIATE
+#endif
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <algorithm>
+
+#include "../cpparse/cpparse.h"
+#include "../benchmarks/lisp_grammar.h"
+#include "../benchmarks/corpus.h"
+
+using namespace cpparse;
+
+typedef parser<lisp::token_pointer, std::string> lisp_parser;
+
+//! Whether two Lisp results are the same tree.
+bool same(const lisp::token_pointer& a, const lisp::token_pointer& b)
+{
+	if (a->text != b->text || a->number != b->number || a->items.size() != b->items.size())
+		return false;
+
+	for (std::size_t i = 0; i < a->items.size(); ++i)
+		if (!same(a->items[i], b->items[i]))
+			return false;
+
+	return true;
+}
+
+//! Whether a reparse of "doc" gives what parsing its text from scratch does.
+bool reparse_matches(incremental_document<lisp_parser>& doc, const lisp_parser& grammar)
+{
+	auto reparsed = doc.parse();
+
+	buffer<std::string> buf(doc.input());
+	auto fresh = grammar->parse(buf);
+
+	return reparsed.is_just() == fresh.is_just() && doc.consumed() == buf.offset()
+		&& (fresh.is_nothing() || same(reparsed.from_just(), fresh.from_just()));
+}
+
+//! Make small edits to a document, and check each reparse, and the one after undoing the edit, against a fresh parse.
+/*! A reused match that looked at the edited input, without the buffer knowing, would make them differ. */
+bool check_incremental(const std::string& name, const lisp_parser& grammar, const std::string& input)
+{
+	const std::string pieces[] = { "", "q", "7", " ", "ab", "(x)", "\"" };
+
+	incremental_document<lisp_parser> doc(grammar, input);
+	doc.parse();
+
+	corpus::random r(7);
+	for (int i = 0; i < 400; ++i)
+	{
+		//! Every fourth edit appends, which a match that ran into the end of the input depends on.
+		auto at = (i % 4) ? r.below(input.size() + 1) : input.size();
+		auto removed = std::min(r.below(3), input.size() - at);
+		auto& inserted = pieces[r.below(sizeof(pieces) / sizeof(pieces[0]))];
+
+		doc.edit(at, removed, inserted);
+		bool edited = reparse_matches(doc, grammar);
+
+		doc.edit(at, inserted.size(), input.substr(at, removed));
+		if (!edited || !reparse_matches(doc, grammar))
+		{
+			std::cerr << name << ": the reparse after edit " << i << " differs from a fresh parse" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// compile and run: g++ -std=c++11 -pthread -o incremental incremental.cpp && ./incremental
+/*! Exits with 1 if any reparse differs from a fresh parse. */
+int main()
+{
+	bool passed = true;
+	for (auto compiled : { false, true })
+	{
+		auto grammar = lisp::grammar(compiled, true);
+		std::string kind = compiled ? "dfa" : "plain";
+
+		passed = check_incremental(kind + "/flat", grammar, corpus::flat(4096)) && passed;
+		passed = check_incremental(kind + "/nested", grammar, corpus::nested(4096)) && passed;
+	}
+
+	return passed ? 0 : 1;
+}
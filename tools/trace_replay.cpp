@@ -0,0 +1,238 @@
+#include <queue>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <algorithm>
+
+#include "../cpparse/trace.h"
+
+using namespace cpparse;
+
+// ******************************************************************
+//! Replay
+// ******************************************************************
+
+namespace
+{
+	const std::uint32_t unknown = 0xffffffffu;
+
+	struct node_stats
+	{
+		std::uint64_t calls, failures, rewinds, rewound;
+
+		node_stats()
+		: calls(0), failures(0), rewinds(0), rewound(0) {}
+	};
+
+	struct rewind_record
+	{
+		std::uint64_t distance, from;
+		std::string path;
+
+		bool operator>(const rewind_record& other) const { return distance > other.distance; }
+	};
+
+	class replay
+	{
+	public:
+		replay(std::size_t top)
+		: m_top(top), m_events(0), m_deepest(0), m_deepest_offset(0) {}
+
+		void run(std::istream& in)
+		{
+			trace_event e;
+			while (in.read(reinterpret_cast<char*>(&e), sizeof(e)))
+			{
+				if (e.kind() == trace_event::name)
+				{
+					std::string name(trace_event::records_for(e.aux) * sizeof(trace_event), '\0');
+					in.read(&name[0], name.size());
+					name.resize(e.aux);
+
+					if (m_names.size() <= e.node())
+						m_names.resize(e.node() + 1);
+					m_names[e.node()] = name;
+					continue;
+				}
+
+				m_events += 1;
+				if (m_stats.size() <= e.node())
+					m_stats.resize(e.node() + 1);
+
+				switch (e.kind())
+				{
+				case trace_event::enter:
+					//! A ring starts part way through a parse; stand in for the calls it lost.
+					m_stack.resize(e.aux, unknown);
+					m_stack.push_back(e.node());
+					m_stats[e.node()].calls += 1;
+
+					if (m_stack.size() > m_deepest)
+					{
+						m_deepest = m_stack.size();
+						m_deepest_offset = e.offset;
+						m_deepest_stack = m_stack;
+					}
+					break;
+
+				case trace_event::fail:
+					m_stats[e.node()].failures += 1;
+					m_stack.resize(std::min<std::size_t>(m_stack.size(), e.aux));
+					break;
+
+				case trace_event::succeed:
+					m_stack.resize(std::min<std::size_t>(m_stack.size(), e.aux));
+					break;
+
+				case trace_event::rewind:
+					m_stats[e.node()].rewinds += 1;
+					m_stats[e.node()].rewound += e.aux;
+					record_rewind(e);
+					break;
+
+				default:
+					break;
+				}
+			}
+		}
+
+		void report(std::ostream& out)
+		{
+			out << m_events << " events, " << m_names.size() << " parsers\n\n";
+
+			out << "Backtracking hot spots (values rewound by each parser):\n";
+			std::vector<std::uint32_t> order;
+			for (std::uint32_t id = 0; id < m_stats.size(); ++id)
+				if (m_stats[id].rewound || m_stats[id].failures)
+					order.push_back(id);
+
+			std::sort(order.begin(), order.end(), [this](std::uint32_t a, std::uint32_t b)
+			{
+				if (m_stats[a].rewound != m_stats[b].rewound)
+					return m_stats[a].rewound > m_stats[b].rewound;
+				return m_stats[a].failures > m_stats[b].failures;
+			});
+
+			if (order.size() > m_top)
+				order.resize(m_top);
+
+			for (auto id : order)
+			{
+				auto& s = m_stats[id];
+				out << "  " << name(id) << ": " << s.rewound << " rewound in " << s.rewinds << " rewinds, "
+					<< s.failures << " of " << s.calls << " calls failed\n";
+			}
+
+			out << "\nLargest rewinds:\n";
+			std::vector<rewind_record> largest;
+			while (!m_largest.empty())
+			{
+				largest.push_back(m_largest.top());
+				m_largest.pop();
+			}
+
+			for (auto r = largest.rbegin(); r != largest.rend(); ++r)
+				out << "  " << r->distance << " back from offset " << r->from << " in " << r->path << "\n";
+
+			out << "\nDeepest recursion: " << m_deepest << " calls, at offset " << m_deepest_offset << "\n";
+
+			//! Deep stacks repeat the same few parsers, so count them rather than listing every frame.
+			std::vector<std::pair<std::uint64_t, std::uint32_t>> frames;
+			for (auto id : m_deepest_stack)
+			{
+				auto found = std::find_if(frames.begin(), frames.end(),
+					[id](const std::pair<std::uint64_t, std::uint32_t>& f) { return f.second == id; });
+
+				if (found == frames.end())
+					frames.push_back(std::make_pair(1, id));
+				else
+					found->first += 1;
+			}
+
+			std::sort(frames.begin(), frames.end(), std::greater<std::pair<std::uint64_t, std::uint32_t>>());
+			if (frames.size() > m_top)
+				frames.resize(m_top);
+
+			for (auto& f : frames)
+				out << "  " << f.first << " x " << name(f.second) << "\n";
+		}
+
+	private:
+		std::string name(std::uint32_t id) const
+		{
+			if (id < m_names.size() && !m_names[id].empty())
+				return m_names[id];
+
+			return id == unknown ? "?" : "#" + std::to_string(id);
+		}
+
+		//! Keep the "m_top" largest rewinds, with the innermost few calls that led to each.
+		void record_rewind(const trace_event& e)
+		{
+			if (m_largest.size() == m_top && m_largest.top().distance >= e.aux)
+				return;
+
+			rewind_record r = { e.aux, e.offset, "" };
+			auto first = m_stack.size() > 4 ? m_stack.size() - 4 : 0;
+			for (auto i = first; i < m_stack.size(); ++i)
+				r.path += (i == first ? (first ? "... > " : "") : " > ") + name(m_stack[i]);
+
+			m_largest.push(r);
+			if (m_largest.size() > m_top)
+				m_largest.pop();
+		}
+
+	private:
+		std::size_t m_top;
+		std::uint64_t m_events;
+
+		std::vector<std::string> m_names;
+		std::vector<node_stats> m_stats;
+		std::vector<std::uint32_t> m_stack;
+
+		std::priority_queue<rewind_record, std::vector<rewind_record>, std::greater<rewind_record>> m_largest;
+
+		std::size_t m_deepest;
+		std::uint64_t m_deepest_offset;
+		std::vector<std::uint32_t> m_deepest_stack;
+	};
+}
+
+// compile and run: g++ -std=c++11 -O2 -o trace_replay trace_replay.cpp && ./trace_replay trace.bin [--top=n]
+/*! Reads a trace written by "cpparse::tracer" and summarizes where the parse spent its effort. */
+int main(int argc, char** argv)
+{
+	const char* file = nullptr;
+	std::size_t top = 10;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!std::strncmp(argv[i], "--top=", 6))
+			top = std::max<std::size_t>(1, std::strtoul(argv[i] + 6, nullptr, 10));
+		else
+			file = argv[i];
+	}
+
+	if (!file)
+	{
+		std::cerr << "usage: trace_replay trace.bin [--top=n]" << std::endl;
+		return 2;
+	}
+
+	std::ifstream in(file, std::ios::binary);
+	trace_header header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !header.valid())
+	{
+		std::cerr << file << ": not a cpparse trace, or written by a different version or byte order" << std::endl;
+		return 1;
+	}
+
+	replay r(top);
+	r.run(in);
+	r.report(std::cout);
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+# Writes cpparse/detail/unicode_tables.h from the Unicode database built into Python.
+# run: python3 tools/unicode_tables.py > cpparse/detail/unicode_tables.h
+
+import sys
+import unicodedata
+
+#! White_Space is a property, not a category, so unicodedata has no list of it.
+WHITE_SPACE = [(0x09, 0x0D), (0x20, 0x20), (0x85, 0x85), (0xA0, 0xA0), (0x1680, 0x1680), (0x2000, 0x200A),
+			   (0x2028, 0x2029), (0x202F, 0x202F), (0x205F, 0x205F), (0x3000, 0x3000)]
+
+
+def ranges(accept):
+	result, start = [], None
+	for cp in range(0x110000 + 1):
+		inside = cp <= 0x10FFFF and accept(unicodedata.category(chr(cp)))
+		if inside and start is None:
+			start = cp
+		elif not inside and start is not None:
+			result.append((start, cp - 1))
+			start = None
+	return result
+
+
+def table(name, description, rs):
+	lines = ["\t//! %s: %d ranges." % (description, len(rs)),
+			 "\tinline const codepoint_range* %s_ranges(std::size_t& count)" % name,
+			 "\t{",
+			 "\t\tstatic const codepoint_range r[] = {"]
+	for i in range(0, len(rs), 6):
+		lines.append("\t\t\t" + " ".join("{ 0x%04X, 0x%04X }," % r for r in rs[i:i + 6]))
+	lines += ["\t\t};",
+			  "",
+			  "\t\tcount = sizeof(r) / sizeof(r[0]);",
+			  "\t\treturn r;",
+			  "\t}"]
+	return "\n".join(lines)
+
+
+def main():
+	out = ["#pragma once",
+		   "",
+		   "// Generated by tools/unicode_tables.py from Unicode %s. Do not edit." % unicodedata.unidata_version,
+		   "",
+		   "#include <cstddef>",
+		   "",
+		   "namespace cpparse",
+		   "{",
+		   "namespace detail",
+		   "{",
+		   "\t//! An inclusive range of code points.",
+		   "\tstruct codepoint_range",
+		   "\t{",
+		   "\t\tchar32_t first, last;",
+		   "\t};",
+		   "",
+		   table("letter", "General categories Lu, Ll, Lt, Lm and Lo", ranges(lambda c: c[0] == "L")),
+		   "",
+		   table("digit", "General category Nd", ranges(lambda c: c == "Nd")),
+		   "",
+		   table("space", "The White_Space property", WHITE_SPACE),
+		   "}",
+		   "}",
+		   ""]
+	sys.stdout.write("\n".join(out))
+
+
+if __name__ == "__main__":
+	main()